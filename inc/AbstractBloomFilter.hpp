@@ -4,12 +4,30 @@
 #include <cstdbool>
 #include <iostream>
 #include <functional>
+#include <type_traits>
+#include "BuiltinHash.hpp"
 
 namespace bloom {
 
+/** Hints the CPU to start fetching the cache line holding the given address.
+ *  Does nothing on compilers without a prefetch builtin.
+ *
+ *  @param p Address that will be read shortly
+ */
+inline void PrefetchRead(const void *p) {
+#if defined(__GNUC__)
+    __builtin_prefetch(p, 0, 1);
+#else
+    (void) p;
+#endif
+}
+
+/** Argument of std::hash specializations for filter keys. It refers to the
+ *  key rather than copying it.
+ */
 template <typename T>
 struct HashParams_S {
-    T a;        //!< Object to hash
+    T const& a; //!< Object to hash
     uint8_t b;  //!< 8-bit salt
 };
 
@@ -17,6 +35,42 @@ struct HashParams_S {
 template <typename T>
 using HashParams = struct HashParams_S;
 
+} // namespace bloom
+
+/** uint32_t keys keep the 32-bit MurmurHash3 they have always used, so that
+ *  existing serialized filters and the TensorFlow kernels stay valid.
+ */
+namespace std {
+    template<>
+    struct hash<bloom::HashParams<uint32_t>> {
+        size_t operator()(bloom::HashParams<uint32_t> const &s) const {
+            uint32_t out;
+            bloom::MurmurHash3::murmur_hash3_x86_32(&s.a, sizeof(s.a), s.b, &out);
+            return out;
+        }
+    };
+}
+
+namespace bloom {
+
+/** Picks the hash of a key type: its std::hash<HashParams<T>>
+ *  specialization when there is one, which must be declared before the
+ *  first filter over T is used, and BuiltinHash<T> otherwise.
+ */
+template <typename T, bool Specialized = std::is_default_constructible<std::hash<HashParams<T>>>::value>
+struct KeyHasher {
+    static size_t Compute(T const& o, uint8_t salt) {
+        return std::hash<HashParams<T>>{}({o, salt});
+    }
+};
+
+template <typename T>
+struct KeyHasher<T, false> {
+    static size_t Compute(T const& o, uint8_t salt) {
+        return BuiltinHash<T>::Compute(o, salt);
+    }
+};
+
 template <typename T>
 class AbstractBloomFilter {
 
@@ -47,8 +101,17 @@ public:
     virtual void Serialize(std::ostream &os) const = 0;
 
 //protected:
-    size_t ComputeHash(T const& o, uint8_t salt) const {
-        return std::hash<HashParams<T>>{}({o, salt});
+    static size_t ComputeHash(T const& o, uint8_t salt) {
+        return KeyHasher<T>::Compute(o, salt);
+    }
+
+protected:
+    /** Changes the recorded shape, for subclasses that reuse their storage
+     *  for a BF of a different size.
+     */
+    void SetShape(uint8_t numHashes, size_t numBytes) {
+        m_numHashes = numHashes;
+        m_numBytes = numBytes;
     }
 
 private:
@@ -20,7 +20,7 @@ public:
      *  @see AbstractBloomFilter::AbstractBloomFilter
      */
     explicit
-    AbstractDeletableBloomFilter(uint8_t numHashes, uint16_t numBits)
+    AbstractDeletableBloomFilter(uint8_t numHashes, size_t numBits)
     : AbstractBloomFilter<T>(numHashes, numBits)
     {}
 
@@ -31,6 +31,14 @@ public:
      */
     virtual bool Delete(T const& o) = 0;
 
+    /** Returns the number of slots. Deletable filters keep one slot (a
+     *  counter or a pair of bits) per bit position, so the size given to
+     *  AbstractBloomFilter is a slot count rather than a byte count.
+     */
+    size_t GetNumBits() const {
+        return AbstractBloomFilter<T>::GetnumBytes();
+    }
+
 }; // class AbstractDeletableBloomFilter
 
 }
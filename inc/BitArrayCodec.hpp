@@ -0,0 +1,365 @@
+#ifndef BitArrayCodec_hpp
+#define BitArrayCodec_hpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "BitOps.hpp"
+
+namespace bloom {
+
+/** Wire encodings for a Bloom filter bit array.
+ */
+enum class Encoding : uint8_t {
+    Raw = 0,        //!< The bytes of the array, unmodified
+    RiceSet = 1,    //!< Golomb-Rice coded gaps between set bits
+    RiceClear = 2   //!< Golomb-Rice coded gaps between clear bits
+};
+
+/** Compact encoding of sparse (or nearly full) bit arrays.
+ *
+ *  The bits of a Bloom filter are close to independent, so the gaps between
+ *  set bits are geometrically distributed and Golomb-Rice coding them comes
+ *  within a few percent of the entropy of the array. Arrays with more set
+ *  than clear bits code the gaps between clear bits instead. The encoding is
+ *  chosen by fill ratio, and Raw is used whenever coding would not be
+ *  smaller.
+ *
+ *  Encoded layout: one Encoding byte, then for Raw the array itself; for the
+ *  Rice forms the Rice parameter (uint8_t), the number of coded bits and the
+ *  byte length of the bit stream (both uint64_t), followed by the stream.
+ */
+class BitArrayCodec {
+
+public:
+
+    /** Picks the encoding expected to be smallest for a bit array.
+     *
+     *  @param bits     Bit array
+     *  @param numBytes Size of the bit array
+     *  @return         Encoding to try
+     */
+    static Encoding Choose(const unsigned char *bits, size_t numBytes) {
+        return ChooseByCount(bits::CountBits(bits, numBytes), 8 * (uint64_t) numBytes);
+    }
+
+    /** Writes a bit array in the smallest applicable encoding.
+     *
+     *  @param bits     Bit array
+     *  @param numBytes Size of the bit array
+     *  @param os       Output stream
+     *  @return         Encoding that was written
+     */
+    static Encoding Encode(const unsigned char *bits, size_t numBytes, std::ostream &os) {
+        Encoding enc = Choose(bits, numBytes);
+        if(enc != Encoding::Raw){
+            std::string stream;
+            uint8_t rice;
+            uint64_t count = RiceEncode(bits, numBytes, enc == Encoding::RiceClear, stream, rice);
+            if(1 + 2 * sizeof(uint64_t) + stream.size() < numBytes){
+                uint64_t length = stream.size();
+                os.write((const char *) &enc, sizeof(uint8_t));
+                os.write((const char *) &rice, sizeof(uint8_t));
+                os.write((const char *) &count, sizeof(uint64_t));
+                os.write((const char *) &length, sizeof(uint64_t));
+                os.write(stream.data(), stream.size());
+                return enc;
+            }
+        }
+        enc = Encoding::Raw;
+        os.write((const char *) &enc, sizeof(uint8_t));
+        os.write((const char *) bits, numBytes);
+        return enc;
+    }
+
+    /** Number of bytes EncodeBlocks materializes and hands to its sink at a
+     *  time.
+     */
+    static const size_t BlockBytes = 64 * 1024;
+
+    /** Writes the same bytes as Encode for a bit array that is produced
+     *  block by block instead of stored, passing the output to a sink in
+     *  chunks of about BlockBytes. The array is never materialized whole:
+     *  it is generated once to count its bits and, for the Rice forms, once
+     *  more to code it into a buffer. Coding stops as soon as the buffer
+     *  would be no smaller than the array, so it stays under numBytes, and
+     *  only then is the array generated a third time to be written raw.
+     *
+     *  @param fill     Called as fill(out, offset, n) to write bytes
+     *                  [offset, offset + n) of the array to out
+     *  @param numBytes Size of the bit array
+     *  @param sink     Called as sink(data, n) with consecutive output chunks
+     *  @return         Encoding that was written
+     */
+    template <typename Fill, typename Sink>
+    static Encoding EncodeBlocks(Fill fill, size_t numBytes, Sink sink) {
+        std::vector<unsigned char> block(numBytes < BlockBytes ? numBytes : BlockBytes);
+        uint64_t numBits = 8 * (uint64_t) numBytes;
+        uint64_t ones = 0;
+        for(size_t offset = 0; offset < numBytes; offset += block.size()){
+            size_t n = std::min(block.size(), numBytes - offset);
+            fill(block.data(), offset, n);
+            ones += bits::CountBits(block.data(), n);
+        }
+
+        const size_t headerBytes = 2 + 2 * sizeof(uint64_t);
+        Encoding enc = ChooseByCount(ones, numBits);
+        if(enc != Encoding::Raw && numBytes >= headerBytes){
+            bool invert = enc == Encoding::RiceClear;
+            uint64_t count = invert ? numBits - ones : ones;
+            uint8_t rice = RiceParameter(count, numBits);
+
+            // The stream must end up shorter than numBytes - headerBytes + 1.
+            const size_t limit = numBytes - headerBytes + 1;
+            std::string stream;
+            stream.reserve((size_t) std::min<uint64_t>(count * (rice + 2) / 8 + 16, limit));
+            BitWriter w(stream);
+            uint64_t next = 0;
+            for(size_t offset = 0; offset < numBytes && stream.size() < limit; offset += block.size()){
+                size_t n = std::min(block.size(), numBytes - offset);
+                fill(block.data(), offset, n);
+                ForEachPosition(block.data(), n, invert, 8 * (uint64_t) offset, [&](uint64_t pos){
+                    uint64_t gap = pos - next;
+                    w.WriteUnary(gap >> rice);
+                    w.Write(gap, rice);
+                    next = pos + 1;
+                });
+            }
+            w.Flush();
+
+            if(stream.size() < limit){
+                uint64_t length = stream.size();
+                unsigned char head[headerBytes];
+                head[0] = (unsigned char) enc;
+                head[1] = rice;
+                std::memcpy(head + 2, &count, sizeof(uint64_t));
+                std::memcpy(head + 2 + sizeof(uint64_t), &length, sizeof(uint64_t));
+                sink((const unsigned char *) head, headerBytes);
+                for(size_t offset = 0; offset < stream.size(); offset += BlockBytes){
+                    sink((const unsigned char *) stream.data() + offset, std::min(BlockBytes, stream.size() - offset));
+                }
+                return enc;
+            }
+        }
+
+        enc = Encoding::Raw;
+        sink((const unsigned char *) &enc, sizeof(uint8_t));
+        for(size_t offset = 0; offset < numBytes; offset += block.size()){
+            size_t n = std::min(block.size(), numBytes - offset);
+            fill(block.data(), offset, n);
+            sink(block.data(), n);
+        }
+        return enc;
+    }
+
+    /** Reads an encoded bit array straight into its storage. No validation
+     *  is performed.
+     *
+     *  @param is       Input stream
+     *  @param bits     Destination bit array
+     *  @param numBytes Size of the bit array
+     */
+    static void Decode(std::istream &is, unsigned char *bits, size_t numBytes) {
+        Encoding enc;
+        is.read((char *) &enc, sizeof(uint8_t));
+        if(enc == Encoding::Raw){
+            is.read((char *) bits, numBytes);
+            return;
+        }
+
+        uint8_t rice;
+        uint64_t count, length;
+        is.read((char *) &rice, sizeof(uint8_t));
+        is.read((char *) &count, sizeof(uint64_t));
+        is.read((char *) &length, sizeof(uint64_t));
+        std::string stream(length, '\0');
+        is.read(&stream[0], length);
+
+        bool invert = enc == Encoding::RiceClear;
+        std::fill(bits, bits + numBytes, invert ? 0xff : 0x00);
+
+        BitReader in((const unsigned char *) stream.data(), stream.size());
+        uint64_t numBits = 8 * (uint64_t) numBytes;
+        uint64_t pos = 0;
+        for(uint64_t i = 0; i < count; i++){
+            // The quotient precedes the remainder in the stream; the operands
+            // of | are unsequenced, so read them in separate statements.
+            uint64_t q = in.ReadUnary();
+            uint64_t r = in.ReadBits(rice);
+            pos += (q << rice) | r;
+            if(pos >= numBits){
+                break;
+            }
+            bits[pos / 8] ^= (unsigned char) (1u << (pos % 8));
+            pos++;
+        }
+    }
+
+private:
+
+    static Encoding ChooseByCount(uint64_t ones, uint64_t numBits) {
+        // Above ~35% fill, Rice codes save too little to be worth a pass.
+        if(20 * ones < 7 * numBits){
+            return Encoding::RiceSet;
+        }
+        if(20 * (numBits - ones) < 7 * numBits){
+            return Encoding::RiceClear;
+        }
+        return Encoding::Raw;
+    }
+
+    /** Optimal Rice parameter for a geometric source: 2^k ~ ln(2) * mean gap.
+     */
+    static uint8_t RiceParameter(uint64_t count, uint64_t numBits) {
+        double mean = count ? (double) (numBits - count) / count : 1.0;
+        return (uint8_t) std::floor(std::log2(std::max(1.0, mean * 0.6931471805599453)));
+    }
+
+    /** Calls f(base + i) for each set bit i of an array (each clear bit if
+     *  invert), in ascending order.
+     */
+    template <typename F>
+    static void ForEachPosition(const unsigned char *bits, size_t numBytes, bool invert, uint64_t base, F f) {
+        const uint64_t flip = invert ? ~0ULL : 0;
+        for(size_t i = 0; i < numBytes; i += 8){
+            size_t n = numBytes - i < 8 ? numBytes - i : 8;
+            uint64_t word = (n == 8 ? bits::LoadWord(bits + i) : bits::LoadPartialWord(bits + i, n)) ^ flip;
+            if(n < 8){
+                word &= (1ULL << (8 * n)) - 1;
+            }
+            while(word != 0){
+                f(base + 8 * (uint64_t) i + bits::CountTrailingZeros(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+    /** Appends bits LSB first to a byte string.
+     */
+    class BitWriter {
+    public:
+        explicit BitWriter(std::string &out) : m_out(out), m_acc(0), m_n(0) {}
+
+        void Write(uint64_t v, unsigned n) {
+            while(n > 32){
+                Write(v & 0xffffffffu, 32);
+                v >>= 32;
+                n -= 32;
+            }
+            m_acc |= (v & ((1ULL << n) - 1)) << m_n;
+            m_n += n;
+            while(m_n >= 8){
+                m_out.push_back((char) (m_acc & 0xff));
+                m_acc >>= 8;
+                m_n -= 8;
+            }
+        }
+
+        /** Writes q in unary: q zeros then a one.
+         */
+        void WriteUnary(uint64_t q) {
+            for(; q >= 32; q -= 32){
+                Write(0, 32);
+            }
+            Write(1ULL << q, (unsigned) q + 1);
+        }
+
+        void Flush() {
+            if(m_n > 0){
+                m_out.push_back((char) (m_acc & 0xff));
+                m_acc = 0;
+                m_n = 0;
+            }
+        }
+
+    private:
+        std::string &m_out;
+        uint64_t m_acc;
+        unsigned m_n;
+    };
+
+    /** Reads bits LSB first, refilling a 64-bit window so unary runs are
+     *  consumed a word at a time.
+     */
+    class BitReader {
+    public:
+        BitReader(const unsigned char *p, size_t n) : m_p(p), m_end(p + n), m_acc(0), m_n(0) {}
+
+        uint64_t ReadBits(unsigned n) {
+            if(n > 32){
+                uint64_t lo = ReadBits(32);
+                return lo | (ReadBits(n - 32) << 32);
+            }
+            Refill();
+            uint64_t v = m_acc & ((1ULL << n) - 1);
+            m_acc >>= n;
+            m_n -= n;
+            return v;
+        }
+
+        uint64_t ReadUnary() {
+            uint64_t q = 0;
+            for(;;){
+                Refill();
+                if(m_acc != 0){
+                    unsigned tz = bits::CountTrailingZeros(m_acc);
+                    m_acc >>= tz;
+                    m_acc >>= 1;
+                    m_n -= tz + 1;
+                    return q + tz;
+                }
+                if(m_p == m_end){
+                    return q + m_n;
+                }
+                q += m_n;
+                m_n = 0;
+            }
+        }
+
+    private:
+        void Refill() {
+            while(m_n <= 56 && m_p != m_end){
+                m_acc |= (uint64_t) *m_p++ << m_n;
+                m_n += 8;
+            }
+        }
+
+        const unsigned char *m_p;
+        const unsigned char *m_end;
+        uint64_t m_acc;
+        unsigned m_n;
+    };
+
+    /** Rice codes the gaps between set bits (or clear bits if invert).
+     *
+     *  @return Number of coded bits
+     */
+    static uint64_t RiceEncode(const unsigned char *bits, size_t numBytes, bool invert,
+                               std::string &out, uint8_t &rice) {
+        uint64_t numBits = 8 * (uint64_t) numBytes;
+        uint64_t ones = bits::CountBits(bits, numBytes);
+        uint64_t count = invert ? numBits - ones : ones;
+        rice = RiceParameter(count, numBits);
+
+        out.clear();
+        out.reserve((size_t) (count * (rice + 2) / 8 + 16));
+        BitWriter w(out);
+        uint64_t next = 0;
+        ForEachPosition(bits, numBytes, invert, 0, [&](uint64_t pos){
+            uint64_t gap = pos - next;
+            w.WriteUnary(gap >> rice);
+            w.Write(gap, rice);
+            next = pos + 1;
+        });
+        w.Flush();
+        return count;
+    }
+
+}; // class BitArrayCodec
+
+} // namespace bloom
+
+#endif
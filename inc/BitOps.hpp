@@ -0,0 +1,429 @@
+#ifndef BitOps_hpp
+#define BitOps_hpp
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace bloom {
+
+/** Word-at-a-time helpers over the byte-addressed bit arrays used by the
+ *  filters. Bit i of an array lives in bit (i % 8) of byte (i / 8), so a
+ *  little-endian 64-bit word at byte offset 8 * w holds bits [64 w, 64 w + 64)
+ *  in order. These helpers hide byte order so word loops work everywhere.
+ */
+namespace bits {
+
+/** Loads 8 bytes as a little-endian word.
+ */
+inline uint64_t LoadWord(const unsigned char *p) {
+    uint64_t w;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    std::memcpy(&w, p, sizeof(w));
+#else
+    w = 0;
+    for(int i = 7; i >= 0; i--){
+        w = (w << 8) | p[i];
+    }
+#endif
+    return w;
+}
+
+/** Loads the first n < 8 bytes as a little-endian word, zero-extended.
+ */
+inline uint64_t LoadPartialWord(const unsigned char *p, size_t n) {
+    uint64_t w = 0;
+    for(size_t i = n; i > 0; i--){
+        w = (w << 8) | p[i - 1];
+    }
+    return w;
+}
+
+/** Stores a word as 8 little-endian bytes.
+ */
+inline void StoreWord(unsigned char *p, uint64_t w) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    std::memcpy(p, &w, sizeof(w));
+#else
+    for(int i = 0; i < 8; i++){
+        p[i] = (unsigned char) (w >> (8 * i));
+    }
+#endif
+}
+
+/** Stores the low n < 8 bytes of a word.
+ */
+inline void StorePartialWord(unsigned char *p, uint64_t w, size_t n) {
+    for(size_t i = 0; i < n; i++){
+        p[i] = (unsigned char) (w >> (8 * i));
+    }
+}
+
+inline unsigned Popcount(uint64_t w) {
+#if defined(__GNUC__)
+    return (unsigned) __builtin_popcountll(w);
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (unsigned) ((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/** Index of the lowest set bit. w must be non-zero.
+ */
+inline unsigned CountTrailingZeros(uint64_t w) {
+#if defined(__GNUC__)
+    return (unsigned) __builtin_ctzll(w);
+#else
+    unsigned n = 0;
+    while(!(w & 1)){
+        w >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/** Counts the set bits of a byte array.
+ */
+inline size_t CountBits(const unsigned char *p, size_t numBytes) {
+    size_t count = 0, i = 0;
+    for(; i + 8 <= numBytes; i += 8){
+        count += Popcount(LoadWord(p + i));
+    }
+    return count + Popcount(LoadPartialWord(p + i, numBytes - i));
+}
+
+/** Returns whether all k bits at the given positions of a bit array are set.
+ *
+ *  There is no branch on the bits: every position is tested and the results
+ *  combined, so the cost does not depend on whether (or where) a probe
+ *  misses. With AVX2, the 32-bit words holding 8 positions are fetched by
+ *  one gather and tested against their masks at once; a group of fewer than
+ *  8 positions is padded by repeating the first.
+ *
+ *  @param bits     Bit array
+ *  @param numBytes Size of the bit array
+ *  @param pos      Bit positions, each below 8 * numBytes
+ *  @param k        Number of positions
+ */
+inline bool TestBits(const unsigned char *bits, size_t numBytes, const size_t *pos, unsigned k) {
+#if defined(__AVX2__)
+    if(k > 0 && numBytes >= 4 && numBytes <= (size_t) INT32_MAX){
+        const __m256i last = _mm256_set1_epi32((int) (numBytes - 4));
+        const __m256i one = _mm256_set1_epi32(1);
+        __m256i missing = _mm256_setzero_si256();
+        for(unsigned i = 0; i < k; i += 8){
+            int32_t byteIndex[8], bitIndex[8];
+            for(unsigned l = 0; l < 8; l++){
+                size_t p = pos[i + l < k ? i + l : 0];
+                byteIndex[l] = (int32_t) (p / 8);
+                bitIndex[l] = (int32_t) (p % 8);
+            }
+            // Gather the word at min(byte, numBytes - 4) so no load runs
+            // past the array, and move the target bit into its mask.
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(byteIndex));
+            __m256i base = _mm256_min_epu32(b, last);
+            __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int *>(bits), base, 1);
+            __m256i shift = _mm256_add_epi32(_mm256_slli_epi32(_mm256_sub_epi32(b, base), 3),
+                                             _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bitIndex)));
+            __m256i mask = _mm256_sllv_epi32(one, shift);
+            missing = _mm256_or_si256(missing, _mm256_andnot_si256(words, mask));
+        }
+        return _mm256_testz_si256(missing, missing);
+    }
+#else
+    (void) numBytes;
+#endif
+    unsigned present = 1;
+    for(unsigned i = 0; i < k; i++){
+        present &= bits[pos[i] / 8] >> (pos[i] % 8);
+    }
+    return present & 1;
+}
+
+/** Arrays at least this large are zeroed with non-temporal stores, which
+ *  bypass the cache instead of evicting the working set with zeros that are
+ *  then mostly rewritten by later inserts.
+ */
+const size_t StreamingZeroThreshold = 1 << 20;
+
+/** Zeroes a byte array, with non-temporal stores when it is large and the
+ *  target supports them.
+ */
+inline void ZeroFill(unsigned char *p, size_t numBytes) {
+#if defined(__SSE2__)
+    if(numBytes >= StreamingZeroThreshold){
+        size_t head = (16 - (reinterpret_cast<uintptr_t>(p) & 15)) & 15;
+        std::memset(p, 0, head);
+        p += head;
+        numBytes -= head;
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for(; i + 16 <= numBytes; i += 16){
+            _mm_stream_si128(reinterpret_cast<__m128i *>(p + i), zero);
+        }
+        // Order the streaming stores before any later ordinary store.
+        _mm_sfence();
+        std::memset(p + i, 0, numBytes - i);
+        return;
+    }
+#endif
+    std::memset(p, 0, numBytes);
+}
+
+/** Packs an array of counters into a bit array holding a 1 for each non-zero
+ *  counter: bit i of the output is set iff counters[i] != 0. Writes
+ *  (n + 7) / 8 bytes.
+ */
+inline void PackNonZero(const uint8_t *counters, size_t n, unsigned char *out) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 16 <= n; i += 16){
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(counters + i));
+        unsigned mask = ~(unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0xffff;
+        out[i / 8] = (unsigned char) mask;
+        out[i / 8 + 1] = (unsigned char) (mask >> 8);
+    }
+#endif
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+    for(; i + 8 <= n; i += 8){
+        uint64_t w = LoadWord(counters + i);
+        // High bit of each byte set iff the byte is non-zero.
+        uint64_t t = (((w & low7) + low7) | w) & ~low7;
+        // Gather the eight high bits into the top byte, byte j to bit j.
+        out[i / 8] = (unsigned char) (((t >> 7) * 0x0102040810204080ULL) >> 56);
+    }
+    if(i < n){
+        unsigned char last = 0;
+        for(size_t j = 0; i + j < n; j++){
+            last |= (unsigned char) ((counters[i + j] != 0) << j);
+        }
+        out[i / 8] = last;
+    }
+}
+
+/** Expands a bit array into n counters of 0 or 1, the inverse of
+ *  PackNonZero for counters no greater than 1.
+ */
+inline void UnpackBits(const unsigned char *bits, size_t n, uint8_t *counters) {
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        // Broadcast the byte, keep bit j in byte j, then map non-zero to 1.
+        uint64_t x = (bits[i / 8] * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+        StoreWord(counters + i, ((x + 0x7f7f7f7f7f7f7f7fULL) >> 7) & 0x0101010101010101ULL);
+    }
+    for(; i < n; i++){
+        counters[i] = (bits[i / 8] >> (i % 8)) & 1;
+    }
+}
+
+/** Combines src into dst word by word: dst = op(dst, src). The loop has no
+ *  dependencies between words, so compilers vectorize it at -O2/-O3.
+ */
+template <typename Op>
+inline void Combine(unsigned char *dst, const unsigned char *src, size_t numBytes, Op op) {
+    size_t i = 0;
+    for(; i + 8 <= numBytes; i += 8){
+        StoreWord(dst + i, op(LoadWord(dst + i), LoadWord(src + i)));
+    }
+    for(; i < numBytes; i++){
+        dst[i] = (unsigned char) op(dst[i], src[i]);
+    }
+}
+
+/** Counts the set bits of op(a, b) without materializing it.
+ */
+template <typename Op>
+inline size_t CountCombined(const unsigned char *a, const unsigned char *b, size_t numBytes, Op op) {
+    size_t count = 0, i = 0;
+    for(; i + 8 <= numBytes; i += 8){
+        count += Popcount(op(LoadWord(a + i), LoadWord(b + i)));
+    }
+    size_t n = numBytes - i;
+    return count + Popcount(op(LoadPartialWord(a + i, n), LoadPartialWord(b + i, n)));
+}
+
+struct OrOp {
+    uint64_t operator()(uint64_t a, uint64_t b) const { return a | b; }
+};
+
+struct AndOp {
+    uint64_t operator()(uint64_t a, uint64_t b) const { return a & b; }
+};
+
+struct AndNotOp {
+    uint64_t operator()(uint64_t a, uint64_t b) const { return a & ~b; }
+};
+
+/** Reverses the order of the bits of a byte.
+ */
+inline unsigned char ReverseByte(unsigned char b) {
+    return (unsigned char) (((b * 0x0202020202ULL) & 0x010884422010ULL) % 1023);
+}
+
+/** Writes bit arrays to a stream as one bit sequence, 8 bits per byte with
+ *  the first bit in the most significant position. Output is buffered and
+ *  the last byte is zero-padded by Flush.
+ */
+class MsbBitWriter {
+
+public:
+
+    explicit
+    MsbBitWriter(std::ostream &os)
+    : m_os(os), m_acc(0), m_count(0), m_used(0)
+    {}
+
+    /** Appends the first n bits of a bit array.
+     */
+    void Append(const unsigned char *bits, size_t n) {
+        for(size_t i = 0; i < n / 8; i++){
+            Push(ReverseByte(bits[i]), 8);
+        }
+        if(n % 8){
+            Push(ReverseByte(bits[n / 8]) >> (8 - n % 8), n % 8);
+        }
+    }
+
+    void Flush() {
+        if(m_count > 0){
+            Emit((unsigned char) (m_acc << (8 - m_count)));
+            m_acc = 0;
+            m_count = 0;
+        }
+        m_os.write((const char *) m_buf, m_used);
+        m_used = 0;
+    }
+
+private:
+
+    /** Appends the low count bits of v, most significant first.
+     */
+    void Push(unsigned v, unsigned count) {
+        m_acc = (m_acc << count) | v;
+        m_count += count;
+        if(m_count >= 8){
+            m_count -= 8;
+            Emit((unsigned char) (m_acc >> m_count));
+            m_acc &= (1u << m_count) - 1;
+        }
+    }
+
+    void Emit(unsigned char b) {
+        if(m_used == sizeof(m_buf)){
+            m_os.write((const char *) m_buf, m_used);
+            m_used = 0;
+        }
+        m_buf[m_used++] = b;
+    }
+
+    std::ostream &m_os;
+    unsigned m_acc, m_count;
+    size_t m_used;
+    unsigned char m_buf[4096];
+};
+
+/** Reads back bit sequences written by MsbBitWriter. Never reads more
+ *  than the given number of bytes, so the stream can hold data after them.
+ */
+class MsbBitReader {
+
+public:
+
+    MsbBitReader(std::istream &is, size_t numBytes)
+    : m_is(is), m_remaining(numBytes), m_acc(0), m_count(0), m_pos(0), m_end(0)
+    {}
+
+    /** Reads the next n bits into a bit array, overwriting its first
+     *  (n + 7) / 8 bytes; bits past n in the last byte are zero.
+     */
+    void Read(unsigned char *bits, size_t n) {
+        for(size_t i = 0; i < n / 8; i++){
+            bits[i] = ReverseByte((unsigned char) Pull(8));
+        }
+        if(n % 8){
+            bits[n / 8] = ReverseByte((unsigned char) (Pull(n % 8) << (8 - n % 8)));
+        }
+    }
+
+private:
+
+    /** Returns the next count <= 8 bits, most significant first.
+     */
+    unsigned Pull(unsigned count) {
+        if(m_count < count){
+            m_acc = (m_acc << 8) | Next();
+            m_count += 8;
+        }
+        m_count -= count;
+        unsigned v = m_acc >> m_count;
+        m_acc &= (1u << m_count) - 1;
+        return v;
+    }
+
+    unsigned char Next() {
+        if(m_pos == m_end){
+            m_is.read((char *) m_buf, std::min(sizeof(m_buf), m_remaining));
+            m_pos = 0;
+            m_end = (size_t) m_is.gcount();
+            m_remaining -= m_end;
+            if(m_end == 0){
+                return 0;
+            }
+        }
+        return m_buf[m_pos++];
+    }
+
+    std::istream &m_is;
+    size_t m_remaining;
+    unsigned m_acc, m_count;
+    size_t m_pos, m_end;
+    unsigned char m_buf[4096];
+};
+
+/** Writes an unsigned integer as a LEB128 varint (7 bits per byte).
+ */
+inline void WriteVarint(std::ostream &os, uint64_t v) {
+    unsigned char buf[10];
+    size_t n = 0;
+    while(v >= 0x80){
+        buf[n++] = (unsigned char) (v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = (unsigned char) v;
+    os.write((const char *) buf, n);
+}
+
+/** Reads a LEB128 varint written by WriteVarint.
+ */
+inline uint64_t ReadVarint(std::istream &is) {
+    uint64_t v = 0;
+    for(unsigned shift = 0; shift < 64; shift += 7){
+        int c = is.get();
+        if(c == EOF){
+            break;
+        }
+        v |= (uint64_t) (c & 0x7f) << shift;
+        if(!(c & 0x80)){
+            break;
+        }
+    }
+    return v;
+}
+
+} // namespace bits
+
+} // namespace bloom
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef BuiltinHash_hpp
+#define BuiltinHash_hpp
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#include "MurmurHash.hpp"
+
+namespace bloom {
+
+/** Seed of the salt-th hash function: a fixed 64-bit pattern per salt.
+ */
+inline uint64_t SaltSeed(uint8_t salt) {
+    return MurmurHash3::fmix64(salt + BIG_CONSTANT(0x9e3779b97f4a7c15));
+}
+
+/** Hashes a byte string with the salt-th hash function (MurmurHash64A).
+ *  This is the built-in hash of strings, so code hashing keys it holds as
+ *  raw bytes can agree with filters over std::string.
+ *
+ *  @param data   Bytes to hash
+ *  @param length Number of bytes
+ *  @param salt   Index of the hash function
+ */
+inline size_t HashBytes(const void *data, size_t length, uint8_t salt) {
+    return (size_t) MurmurHash3::murmur_hash64a(data, length, SaltSeed(salt));
+}
+
+/** Hashes used for keys that have no std::hash<HashParams<T>>
+ *  specialization:
+ *
+ *  - integral and enum types of up to 64 bits are mixed in registers with
+ *    the MurmurHash3 finalizer;
+ *  - std::basic_string (and std::basic_string_view in C++17) hash their
+ *    characters with HashBytes;
+ *  - other trivially copyable types hash their object representation with
+ *    HashBytes. Such types must have no padding bits, and floating point
+ *    keys hash 0.0 and -0.0 differently.
+ *
+ *  Other types have no built-in hash and need a std::hash specialization.
+ */
+template <typename T, typename Enable = void>
+struct BuiltinHash;
+
+/** Whether T is a string view, which is trivially copyable but hashed by
+ *  its characters.
+ */
+template <typename T>
+struct IsStringView : std::false_type {};
+
+#if __cplusplus >= 201703L
+template <typename C, typename Traits>
+struct IsStringView<std::basic_string_view<C, Traits>> : std::true_type {};
+#endif
+
+template <typename T>
+struct BuiltinHash<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type> {
+    static size_t Compute(T o, uint8_t salt) {
+        if (sizeof(T) > sizeof(uint64_t)) {
+            return HashBytes(&o, sizeof(T), salt);
+        }
+        return (size_t) MurmurHash3::fmix64((uint64_t) o ^ SaltSeed(salt));
+    }
+};
+
+template <typename T>
+struct BuiltinHash<T, typename std::enable_if<std::is_trivially_copyable<T>::value
+                                              && !std::is_integral<T>::value
+                                              && !std::is_enum<T>::value
+                                              && !IsStringView<T>::value>::type> {
+    static size_t Compute(T const& o, uint8_t salt) {
+        return HashBytes(&o, sizeof(T), salt);
+    }
+};
+
+template <typename C, typename Traits, typename A>
+struct BuiltinHash<std::basic_string<C, Traits, A>> {
+    static size_t Compute(std::basic_string<C, Traits, A> const& s, uint8_t salt) {
+        return HashBytes(s.data(), s.size() * sizeof(C), salt);
+    }
+};
+
+#if __cplusplus >= 201703L
+template <typename C, typename Traits>
+struct BuiltinHash<std::basic_string_view<C, Traits>> {
+    static size_t Compute(std::basic_string_view<C, Traits> s, uint8_t salt) {
+        return HashBytes(s.data(), s.size() * sizeof(C), salt);
+    }
+};
+#endif
+
+} // namespace bloom
+
+#endif
@@ -1,12 +1,22 @@
 #ifndef CountingBloomFilter_hpp
 #define CountingBloomFilter_hpp
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 #include "AbstractDeletableBloomFilter.hpp"
+#include "BitOps.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 // forward decl
 namespace bloom {
-    template <typename T>
+    template <typename T, typename Alloc = std::allocator<uint8_t>>
     class CountingBloomFilter;
 }
 
@@ -18,110 +28,501 @@ namespace bloom {
  *  bytes. Each byte is incremented for an added item, or decremented for a
  *  deleted item, thereby supporting a delete operation.
  *
- *  @param T Contained type being indexed
+ *  @param T     Contained type being indexed
+ *  @param Alloc Allocator for the counter array
  */
-template <typename T>
+template <typename T, typename Alloc>
 class CountingBloomFilter : public AbstractDeletableBloomFilter<T> {
 
 public:
 
+    /** Alloc rebound to another element type, for the arrays of converted BFs.
+     */
+    template <typename U>
+    using Rebind = typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+
     /** Constructor
      *  @see AbstractBloomFilter::AbstractBloomFilter
      */
     explicit
-    CountingBloomFilter(uint8_t numHashes, uint16_t numBits)
-    : AbstractDeletableBloomFilter<T>(numHashes, numBits)
+    CountingBloomFilter(uint8_t numHashes, size_t numBits, Alloc const& alloc = Alloc())
+    : AbstractDeletableBloomFilter<T>(numHashes, numBits), m_bitarray(alloc)
     {
-        m_bitarray.reserve(numBits);
-        for(uint16_t i = 0; i < super::GetNumBits(); i++){
-            m_bitarray[i] = 0;
-        }
+        m_bitarray.resize(numBits, 0);
     }
     
+    /** Inserts an object. Counters saturate at MaxCount rather than wrap.
+     */
     virtual void Insert(T const& o) {
         for(uint8_t i = 0; i < super::GetNumHashes(); i++){
-            m_bitarray[super::ComputeHash(o, i)] += 1;
+            size_t slot = super::ComputeHash(o, i) % super::GetNumBits();
+            if(m_bitarray[slot] != MaxCount){
+                m_bitarray[slot] += 1;
+            }
+            if(!m_dirty.empty()){
+                MarkDirty(slot);
+            }
+        }
+    }
+    
+    /** Inserts an object like Insert, but may be called by several threads
+     *  at once on the same BF: each counter is incremented with an atomic
+     *  compare-and-swap that saturates at MaxCount. No other operation may
+     *  run concurrently with it.
+     *
+     *  @param o Object to insert
+     */
+    void InsertShared(T const& o) {
+        for(uint8_t i = 0; i < super::GetNumHashes(); i++){
+            size_t slot = super::ComputeHash(o, i) % super::GetNumBits();
+            uint8_t *counter = &m_bitarray[slot];
+            uint8_t count = __atomic_load_n(counter, __ATOMIC_RELAXED);
+            while(count != MaxCount
+                  && !__atomic_compare_exchange_n(counter, &count, (uint8_t) (count + 1), true,
+                                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+            }
+            if(!m_dirty.empty()){
+                size_t page = slot / CheckpointPageSize;
+                __atomic_fetch_or(&m_dirty[page / 64], 1ULL << (page % 64), __ATOMIC_RELAXED);
+            }
+        }
+    }
+    
+    /** Inserts an object with conservative update: only the counters equal
+     *  to its current minimum are incremented. EstimateCount then
+     *  overestimates much less, but Delete can no longer be used on this BF
+     *  without risking false negatives.
+     *
+     *  @param o Object to insert
+     */
+    void InsertConservative(T const& o) {
+        uint8_t count = EstimateCount(o);
+        if(count == MaxCount){
+            return;
+        }
+        for(uint8_t i = 0; i < super::GetNumHashes(); i++){
+            size_t slot = super::ComputeHash(o, i) % super::GetNumBits();
+            if(m_bitarray[slot] == count){
+                m_bitarray[slot] = count + 1;
+                if(!m_dirty.empty()){
+                    MarkDirty(slot);
+                }
+            }
         }
     }
     
+    /** Deletes an object. Saturated counters are left alone, since their
+     *  true value is unknown.
+     */
     virtual bool Delete(T const& o) {
         if(Query(o)){
             for(uint8_t i = 0; i < super::GetNumHashes(); i++){
-                m_bitarray[super::ComputeHash(o, i)] -= 1;
+                size_t slot = super::ComputeHash(o, i) % super::GetNumBits();
+                if(m_bitarray[slot] != MaxCount){
+                    m_bitarray[slot] -= 1;
+                }
+                if(!m_dirty.empty()){
+                    MarkDirty(slot);
+                }
             }
             return true;
         }
         return false;
     }
     
+    /** Estimates how many times an object was inserted (less deleted), as
+     *  the minimum of its counters, as in a count-min sketch. Never below
+     *  the true count unless counters saturated or Delete was misused.
+     *
+     *  @param  o Object to query
+     *  @return   Estimated count, at most MaxCount
+     */
+    uint8_t EstimateCount(T const& o) const {
+        uint8_t count = MaxCount;
+        for(uint8_t i = 0; i < super::GetNumHashes(); i++){
+            count = std::min(count, m_bitarray[super::ComputeHash(o, i) % super::GetNumBits()]);
+        }
+        return count;
+    }
+    
+    /** Estimates the counts of an array of objects; equivalent to calling
+     *  EstimateCount on each. Objects are processed 8 at a time: hashes are
+     *  computed first, then the counters of all 8 are fetched together,
+     *  with an AVX2 gather when available.
+     *
+     *  @param keys Objects to query
+     *  @param n    Number of objects
+     *  @param out  Receives n counts
+     */
+    void EstimateCountBatch(T const* keys, size_t n, uint8_t *out) const {
+        const uint8_t numHashes = super::GetNumHashes();
+        const size_t numBits = super::GetNumBits();
+        const uint8_t *counters = m_bitarray.data();
+        // Objects [0, full) go 8 at a time; fixed bounds let the compiler
+        // prove the trip count of every loop.
+        const size_t full = n - n % 8;
+        size_t j = 0;
+#if defined(__AVX2__)
+        if(numBits >= 4 && numBits <= (size_t) INT32_MAX){
+            // Positions fit the 32-bit lanes of the gather.
+            uint32_t pos[8];
+            const __m256i lastWord = _mm256_set1_epi32((int) (numBits - 4));
+            const __m256i low8 = _mm256_set1_epi32(0xff);
+            for(; j < full; j += 8){
+                __m256i count = _mm256_set1_epi32(MaxCount);
+                for(uint8_t i = 0; i < numHashes; i++){
+                    for(int l = 0; l < 8; l++){
+                        pos[l] = (uint32_t) (super::ComputeHash(keys[j + l], i) % numBits);
+                    }
+                    // Gather the 32-bit word at min(pos, numBits - 4), so no
+                    // load runs past the array, and shift the counter down.
+                    __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pos));
+                    __m256i base = _mm256_min_epu32(p, lastWord);
+                    __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int *>(counters), base, 1);
+                    __m256i shift = _mm256_slli_epi32(_mm256_sub_epi32(p, base), 3);
+                    count = _mm256_min_epu32(count, _mm256_and_si256(_mm256_srlv_epi32(words, shift), low8));
+                }
+                uint32_t c[8];
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(c), count);
+                for(int l = 0; l < 8; l++){
+                    out[j + l] = (uint8_t) c[l];
+                }
+            }
+        }
+#endif
+        size_t pos[8];
+        for(; j < full; j += 8){
+            uint8_t count[8];
+            std::fill(count, count + 8, MaxCount);
+            for(uint8_t i = 0; i < numHashes; i++){
+                for(int l = 0; l < 8; l++){
+                    pos[l] = super::ComputeHash(keys[j + l], i) % numBits;
+                    PrefetchRead(counters + pos[l]);
+                }
+                for(int l = 0; l < 8; l++){
+                    count[l] = std::min(count[l], counters[pos[l]]);
+                }
+            }
+            std::copy(count, count + 8, out + j);
+        }
+        for(size_t l = 0; l < n % 8; l++){
+            out[full + l] = EstimateCount(keys[full + l]);
+        }
+    }
+    
+    /** Returns the k candidates with the highest estimated counts, highest
+     *  first, for finding heavy hitters among a known universe of objects.
+     *  Candidates with a count of zero are never returned.
+     *
+     *  @param candidates Objects to rank
+     *  @param n          Number of candidates
+     *  @param k          Maximum number of results
+     *  @return           Pairs of candidate and estimated count
+     */
+    std::vector<std::pair<T, uint8_t>> TopK(T const* candidates, size_t n, size_t k) const {
+        std::vector<uint8_t> counts(n);
+        EstimateCountBatch(candidates, n, counts.data());
+        
+        std::vector<size_t> order;
+        for(size_t j = 0; j < n; j++){
+            if(counts[j] > 0){
+                order.push_back(j);
+            }
+        }
+        k = std::min(k, order.size());
+        std::partial_sort(order.begin(), order.begin() + k, order.end(),
+                          [&](size_t a, size_t b){ return counts[a] > counts[b] || (counts[a] == counts[b] && a < b); });
+        
+        std::vector<std::pair<T, uint8_t>> res;
+        res.reserve(k);
+        for(size_t j = 0; j < k; j++){
+            res.push_back(std::make_pair(candidates[order[j]], counts[order[j]]));
+        }
+        return res;
+    }
+    
     virtual bool Query(T const& o) const {
         for(uint8_t i = 0; i < super::GetNumHashes(); i++){
-            if(m_bitarray[super::ComputeHash(o, i)] == 0){
+            if(m_bitarray[super::ComputeHash(o, i) % super::GetNumBits()] == 0){
                 return false;
             }
         }
         return true;
     }
     
+    /** Serializes the number of hashes (uint8_t), the number of counters
+     *  (uint64_t), then the counters.
+     */
     virtual void Serialize(std::ostream &os) const {
         uint8_t numHashes = super::GetNumHashes();
-        uint16_t numBits = super::GetNumBits();
+        uint64_t numBits = super::GetNumBits();
 
         os.write((const char *) &numHashes, sizeof(uint8_t));
-        os.write((const char *) &numBits, sizeof(uint16_t));
-        
-        for(uint16_t i = 0; i < numBits; i++){
-            uint8_t byte = m_bitarray[i];
-            os.write((const char *) &byte, sizeof(uint8_t));
-        }
+        os.write((const char *) &numBits, sizeof(uint64_t));
+        os.write((const char *) m_bitarray.data(), numBits);
     }
     
     /** Create a CountingBloomFilter from the content of a binary input
      * stream. No validation is performed.
      *
-     * @param  is Input stream to read from
+     * @param  is    Input stream to read from
+     * @param  alloc Allocator for the counter array of the result
      * @return Deserialized CountingBloomFilter
      */
-    static CountingBloomFilter<T> Deserialize(std::istream &is){
+    static CountingBloomFilter Deserialize(std::istream &is, Alloc const& alloc = Alloc()){
         uint8_t numHashes;
-        uint16_t numBits;
+        uint64_t numBits;
         
         is.read((char *) &numHashes, sizeof(uint8_t));
-        is.read((char *) &numBits, sizeof(uint16_t));
+        is.read((char *) &numBits, sizeof(uint64_t));
         
-        CountingBloomFilter<T> r (numHashes, numBits);
+        CountingBloomFilter r (numHashes, numBits, alloc);
+        is.read((char *) r.m_bitarray.data(), numBits);
         
-        for(uint16_t i = 0; i < numBits; i++){
-            uint8_t byte;
-            is.read((char *) &byte, sizeof(uint8_t));
-            r.m_bitarray[i] = byte;
+        return r;
+    }
+    
+    /** Starts or stops tracking which pages of CheckpointPageSize counters
+     *  are modified by Insert and Delete, for incremental checkpoints.
+     *  Starting tracking clears the set of modified pages.
+     *
+     *  A checkpoint scheme built on this: write a base image with Serialize
+     *  and enable tracking; periodically append SerializeChanges to a log;
+     *  compact by writing a new base image and truncating the log. Restore
+     *  replays the log over the base image.
+     *
+     *  @param enable Whether to track changes
+     */
+    void TrackChanges(bool enable){
+        size_t numPages = (super::GetNumBits() + CheckpointPageSize - 1) / CheckpointPageSize;
+        m_dirty.assign(enable ? (numPages + 63) / 64 : 0, 0);
+    }
+    
+    /** Appends one log record holding the pages modified since tracking
+     *  started or since the last call, then forgets them. Tracking must be
+     *  enabled.
+     *  @see TrackChanges
+     *
+     *  Record format: the shape of this BF (numHashes as uint8_t, then the
+     *  number of counters as size_t), the number of pages (uint64_t), then
+     *  for each page its index (uint64_t) and its counters.
+     *
+     *  @param os Output stream (typically the append-only log)
+     *  @return   Number of pages written
+     */
+    size_t SerializeChanges(std::ostream &os){
+        std::vector<uint64_t> pages;
+        for(size_t d = 0; d < m_dirty.size(); d++){
+            for(uint64_t w = m_dirty[d]; w != 0; w &= w - 1){
+                pages.push_back(64 * d + bits::CountTrailingZeros(w));
+            }
+            m_dirty[d] = 0;
         }
         
+        uint8_t numHashes = super::GetNumHashes();
+        size_t numBits = super::GetNumBits();
+        uint64_t count = pages.size();
+        os.write((const char *) &numHashes, sizeof(uint8_t));
+        os.write((const char *) &numBits, sizeof(size_t));
+        os.write((const char *) &count, sizeof(uint64_t));
+        for(size_t p = 0; p < pages.size(); p++){
+            size_t offset = pages[p] * CheckpointPageSize;
+            os.write((const char *) &pages[p], sizeof(uint64_t));
+            os.write((const char *) m_bitarray.data() + offset, PageLength(offset));
+        }
+        return pages.size();
+    }
+    
+    /** Replays every record of a log written by SerializeChanges, in order,
+     *  until the end of the stream. Each record is read and checked in full
+     *  before any counter is written. A record cut short by the end of the
+     *  stream, as left by a crash while appending, is dropped and ends the
+     *  replay.
+     *
+     *  @param is Input stream positioned at the first record
+     *  @return   Number of records applied
+     *  @throws std::invalid_argument if a record was written by a BF of
+     *          another shape or names a page outside the counter array
+     */
+    size_t ApplyChanges(std::istream &is){
+        const size_t numPages = (super::GetNumBits() + CheckpointPageSize - 1) / CheckpointPageSize;
+        std::vector<uint64_t> pages;
+        std::vector<uint8_t> counters;
+        size_t records = 0;
+        for(;;){
+            uint8_t numHashes;
+            size_t numBits;
+            uint64_t count;
+            is.read((char *) &numHashes, sizeof(uint8_t));
+            is.read((char *) &numBits, sizeof(size_t));
+            is.read((char *) &count, sizeof(uint64_t));
+            if(!is){
+                return records;
+            }
+            if(numHashes != super::GetNumHashes() || numBits != super::GetNumBits()){
+                throw std::invalid_argument("CountingBloomFilter::ApplyChanges: record is for a BF of another shape");
+            }
+
+            pages.clear();
+            counters.clear();
+            for(uint64_t p = 0; p < count; p++){
+                uint64_t page;
+                if(!is.read((char *) &page, sizeof(uint64_t))){
+                    return records;
+                }
+                if(page >= numPages){
+                    throw std::invalid_argument("CountingBloomFilter::ApplyChanges: page index out of range");
+                }
+                size_t n = PageLength(page * CheckpointPageSize);
+                counters.resize(counters.size() + n);
+                if(!is.read((char *) counters.data() + counters.size() - n, n)){
+                    return records;
+                }
+                pages.push_back(page);
+            }
+
+            const uint8_t *src = counters.data();
+            for(size_t p = 0; p < pages.size(); p++){
+                size_t offset = pages[p] * CheckpointPageSize;
+                size_t n = PageLength(offset);
+                std::copy(src, src + n, m_bitarray.begin() + offset);
+                src += n;
+                if(!m_dirty.empty()){
+                    MarkDirty(offset);
+                }
+            }
+            records++;
+        }
+    }
+    
+    /** Rebuilds a CountingBloomFilter from a base image written by Serialize
+     *  and a log of SerializeChanges records written after it.
+     *
+     *  @param  base  Input stream holding the base image
+     *  @param  log   Input stream holding the change log
+     *  @param  alloc Allocator for the counter array of the result
+     *  @return Restored CountingBloomFilter
+     */
+    static CountingBloomFilter Restore(std::istream &base, std::istream &log, Alloc const& alloc = Alloc()){
+        CountingBloomFilter r = Deserialize(base, alloc);
+        r.ApplyChanges(log);
         return r;
     }
     
     /** Returns an ordinary BF with the same set represented by this counting
-     *  BF.
+     *  BF. The number of counters must be a multiple of 8: the ordinary BF
+     *  reduces hashes modulo its size in bits, so any other count would put
+     *  its bits in different positions than the counters.
      *
-     *  @return The new OrdinaryBloomFilter
+     *  @return The new OrdinaryBloomFilter, allocating from this BF's allocator
+     *  @throws std::invalid_argument if the number of counters is not a
+     *          multiple of 8
      */
-    OrdinaryBloomFilter<T> ToOrdinaryBloomFilter() const {
-        OrdinaryBloomFilter<T> res(super::GetNumHashes(), super::GetNumBits());
-        for(int i = 0; i < super::GetNumBits(); i++){
-            res.m_bitarray[i] = m_bitarray[i] > 0;
-        }
+    OrdinaryBloomFilter<T, Rebind<unsigned char>> ToOrdinaryBloomFilter() const {
+        OrdinaryBloomFilter<T, Rebind<unsigned char>> res(super::GetNumHashes(), 0, m_bitarray.get_allocator());
+        ToOrdinary(res);
         return res;
     }
     
+    /** Overwrites an ordinary BF with the one ToOrdinaryBloomFilter would
+     *  return, reusing its storage when large enough. Counters are packed
+     *  16 (SSE2) or 8 at a time.
+     *
+     *  @param out Destination BF
+     *  @throws std::invalid_argument if the number of counters is not a
+     *          multiple of 8
+     */
+    template <typename A>
+    void ToOrdinary(OrdinaryBloomFilter<T, A>& out) const {
+        if(super::GetNumBits() % 8 != 0){
+            throw std::invalid_argument("CountingBloomFilter::ToOrdinary: number of counters is not a multiple of 8");
+        }
+        out.Reshape(super::GetNumHashes(), (super::GetNumBits() + 7) / 8);
+        out.m_layout = Layout::Standard;
+        bits::PackNonZero(m_bitarray.data(), super::GetNumBits(), out.m_bitarray.data());
+        out.MarkAllDirty();
+    }
+    
+    /** Empties this BF and gives it a new shape, reusing the storage when
+     *  it is large enough.
+     *
+     *  @param numHashes Number of hashes per object
+     *  @param numBits   Number of counters
+     */
+    void Reset(uint8_t numHashes, size_t numBits){
+        Reshape(numHashes, numBits);
+        Clear();
+    }
+    
+    /** Resets every counter to zero, keeping the storage. Large arrays are
+     *  zeroed with non-temporal stores.
+     */
+    void Clear(){
+        bits::ZeroFill(m_bitarray.data(), m_bitarray.size());
+        MarkAllDirty();
+    }
+    
+    /** Largest counter value; counters stick there once reached.
+     */
+    static const uint8_t MaxCount = 255;
+    
+    /** Number of counters per page tracked for incremental checkpoints.
+     */
+    static const size_t CheckpointPageSize = 4096;
+    
+    template <typename U, typename A>
+    friend class OrdinaryBloomFilter;
+    
+    template <typename U, typename A>
+    friend class CountingBloomFilter;
+    
 private:
     
     typedef AbstractDeletableBloomFilter<T> super;
     
-    std::vector<uint8_t> m_bitarray;
+    /** Resizes the storage for a new shape without clearing it.
+     */
+    void Reshape(uint8_t numHashes, size_t numBits) {
+        super::SetShape(numHashes, numBits);
+        m_bitarray.resize(numBits);
+        if(!m_dirty.empty()){
+            TrackChanges(true);
+        }
+    }
+    
+    void MarkAllDirty() {
+        if(!m_dirty.empty()){
+            for(size_t slot = 0; slot < super::GetNumBits(); slot += CheckpointPageSize){
+                MarkDirty(slot);
+            }
+        }
+    }
+    
+    void MarkDirty(size_t slot) {
+        size_t page = slot / CheckpointPageSize;
+        m_dirty[page / 64] |= 1ULL << (page % 64);
+    }
+    
+    size_t PageLength(size_t offset) const {
+        size_t remaining = super::GetNumBits() - offset;
+        return remaining < CheckpointPageSize ? remaining : CheckpointPageSize;
+    }
+    
+    std::vector<uint8_t, Alloc> m_bitarray;
+    
+    /** One bit per page of m_bitarray; empty when not tracking.
+     */
+    std::vector<uint64_t> m_dirty;
     
 
 }; // class CountingBloomFilter
 
+template <typename T, typename Alloc>
+const uint8_t CountingBloomFilter<T, Alloc>::MaxCount;
+
+template <typename T, typename Alloc>
+const size_t CountingBloomFilter<T, Alloc>::CheckpointPageSize;
+
 } // namespace bloom
 
 #endif
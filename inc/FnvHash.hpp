@@ -1,6 +1,7 @@
 #ifndef FnvHash_hpp
 #define FnvHash_hpp
 
+#include <cstddef>
 #include <cstdint>
 
 namespace bloom {
@@ -20,15 +21,26 @@ public:
     : m_hash(Offset)
     {}
     
+    /** Consumes a single value and updates the hash.
+     *
+     *  @param buf Value to hash
+     */
+    void Update(const int buf){
+        m_hash = m_hash * Prime;
+        m_hash = m_hash ^ buf;
+    }
+
     /** Consumes input and updates the hash. Can be called several
      *  times to process data in chunks.
      *
      *  @param buf Buffer of bytes to hash
      *  @param len Number of bytes in buffer
      */
-    void Update(const int buf){
-        m_hash = m_hash * Prime;
-        m_hash = m_hash ^ buf;
+    void Update(const void *buf, size_t len){
+        const uint8_t *bytes = (const uint8_t *) buf;
+        for(size_t i = 0; i < len; i++){
+            Update(bytes[i]);
+        }
     }
     
     /** Returns the hash digest.
@@ -0,0 +1,239 @@
+#ifndef LargePageAllocator_hpp
+#define LargePageAllocator_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bloom {
+
+/** Page size used to back a large bit array.
+ */
+enum class PagePolicy {
+    Default,            //!< Ordinary 4 KB pages
+    TransparentHuge,    //!< 2 MB aligned mapping, advised for transparent huge pages
+    ExplicitHuge        //!< MAP_HUGETLB pages, falling back to TransparentHuge
+};
+
+/** NUMA placement of a large bit array.
+ */
+enum class NumaPolicy {
+    FirstTouch,         //!< Kernel default: pages land on the node that touches them first
+    Interleave,         //!< Pages are spread round-robin over all online nodes
+    Bind                //!< Pages are placed on a single node
+};
+
+/** Returns the number of NUMA nodes known to the kernel, or 1 if this cannot
+ *  be determined.
+ */
+inline int NumaNodeCount() {
+    std::ifstream in("/sys/devices/system/node/online");
+    std::string ranges;
+    if(!(in >> ranges)){
+        return 1;
+    }
+    // Format is a list such as "0" or "0-1,3"; the last number is the highest node.
+    size_t start = ranges.find_last_of(",-");
+    int last = std::atoi(ranges.c_str() + (start == std::string::npos ? 0 : start + 1));
+    return last + 1;
+}
+
+/** Returns the NUMA node of the CPU the calling thread currently runs on.
+ */
+inline int CurrentNumaNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if(syscall(SYS_getcpu, &cpu, &node, nullptr) == 0){
+        return (int) node;
+    }
+#endif
+    return 0;
+}
+
+/** Allocator for large bit arrays. Small requests are served from cache-line
+ *  aligned heap memory; requests of at least one huge page are mapped
+ *  directly, aligned to HugePageSize, backed by huge pages according to the
+ *  PagePolicy and placed according to the NumaPolicy. Placement is applied
+ *  before the memory is first touched, so it holds once the container
+ *  value-initializes the array.
+ *
+ *  All instances can free each other's memory and thus compare equal.
+ *
+ *  @param U Element type
+ */
+template <typename U>
+class LargePageAllocator {
+
+public:
+
+    typedef U value_type;
+
+    static const size_t HugePageSize = 2 * 1024 * 1024;
+    static const size_t Alignment = 64;
+
+    /** Constructor
+     *
+     *  @param pages Page size policy for large allocations
+     *  @param numa  NUMA placement for large allocations
+     *  @param node  Target node when numa is NumaPolicy::Bind
+     */
+    explicit
+    LargePageAllocator(PagePolicy pages = PagePolicy::TransparentHuge,
+                       NumaPolicy numa = NumaPolicy::FirstTouch, int node = 0)
+    : m_pages(pages), m_numa(numa), m_node(node)
+    {}
+
+    template <typename V>
+    LargePageAllocator(LargePageAllocator<V> const& other)
+    : m_pages(other.GetPagePolicy()), m_numa(other.GetNumaPolicy()), m_node(other.GetNode())
+    {}
+
+    U* allocate(size_t n) {
+        size_t bytes = n * sizeof(U);
+        void *p = nullptr;
+#ifdef __linux__
+        if(bytes >= HugePageSize){
+            p = MapLarge(RoundUp(bytes));
+        } else
+#endif
+        if(posix_memalign(&p, Alignment, bytes ? bytes : 1) != 0){
+            p = nullptr;
+        }
+        if(p == nullptr){
+            throw std::bad_alloc();
+        }
+        return static_cast<U*>(p);
+    }
+
+    void deallocate(U* p, size_t n) {
+#ifdef __linux__
+        size_t bytes = n * sizeof(U);
+        if(bytes >= HugePageSize){
+            munmap(p, RoundUp(bytes));
+            return;
+        }
+#else
+        (void) n;
+#endif
+        free(p);
+    }
+
+    PagePolicy GetPagePolicy() const {
+        return m_pages;
+    }
+
+    NumaPolicy GetNumaPolicy() const {
+        return m_numa;
+    }
+
+    int GetNode() const {
+        return m_node;
+    }
+
+private:
+
+    static size_t RoundUp(size_t bytes) {
+        return (bytes + HugePageSize - 1) / HugePageSize * HugePageSize;
+    }
+
+#ifdef __linux__
+    void* MapLarge(size_t len) const {
+        void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if(m_pages == PagePolicy::ExplicitHuge){
+            p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if(p == MAP_FAILED){
+            p = MapAligned(len);
+            if(p == nullptr){
+                return nullptr;
+            }
+#ifdef MADV_HUGEPAGE
+            if(m_pages != PagePolicy::Default){
+                madvise(p, len, MADV_HUGEPAGE);
+            }
+#endif
+        }
+        Place(p, len);
+        return p;
+    }
+
+    /** Maps len bytes aligned to HugePageSize by over-mapping one huge page
+     *  and trimming the excess on both sides.
+     */
+    static void* MapAligned(size_t len) {
+        size_t span = len + HugePageSize;
+        void *raw = mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(raw == MAP_FAILED){
+            return nullptr;
+        }
+        uintptr_t base = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = (base + HugePageSize - 1) & ~(uintptr_t) (HugePageSize - 1);
+        if(aligned > base){
+            munmap(raw, aligned - base);
+        }
+        size_t tail = base + span - (aligned + len);
+        if(tail > 0){
+            munmap(reinterpret_cast<void*>(aligned + len), tail);
+        }
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    /** Applies the NUMA policy to a fresh mapping. Failure (e.g. a kernel
+     *  without NUMA support) silently leaves first-touch placement.
+     */
+    void Place(void *p, size_t len) const {
+#ifdef SYS_mbind
+        const int MpolBind = 2, MpolInterleave = 3;
+        const unsigned long maxNode = 8 * sizeof(unsigned long);
+        unsigned long mask = 0;
+        int mode;
+        if(m_numa == NumaPolicy::Interleave){
+            int nodes = NumaNodeCount();
+            mask = nodes >= (int) maxNode ? ~0UL : (1UL << nodes) - 1;
+            mode = MpolInterleave;
+        } else if(m_numa == NumaPolicy::Bind && m_node >= 0 && m_node < (int) maxNode){
+            mask = 1UL << m_node;
+            mode = MpolBind;
+        } else {
+            return;
+        }
+        syscall(SYS_mbind, p, len, mode, &mask, maxNode + 1, 0);
+#else
+        (void) p;
+        (void) len;
+#endif
+    }
+#endif
+
+    PagePolicy m_pages;
+    NumaPolicy m_numa;
+    int m_node;
+
+}; // class LargePageAllocator
+
+template <typename U, typename V>
+bool operator==(LargePageAllocator<U> const&, LargePageAllocator<V> const&) {
+    return true;
+}
+
+template <typename U, typename V>
+bool operator!=(LargePageAllocator<U> const&, LargePageAllocator<V> const&) {
+    return false;
+}
+
+} // namespace bloom
+
+#endif
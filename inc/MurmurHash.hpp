@@ -1,7 +1,9 @@
 #ifndef _MURMURHASH_H_
 #define _MURMURHASH_H_
 
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 namespace bloom {
 
@@ -19,6 +21,18 @@ public:
 
     MurmurHash3() {}
 
+    /** 64-bit finalization mix of MurmurHash3: a fast bijective mixer
+     *  whose output bits each depend on all input bits.
+     */
+    static uint64_t fmix64(uint64_t k) {
+      k ^= k >> 33;
+      k *= BIG_CONSTANT(0xff51afd7ed558ccd);
+      k ^= k >> 33;
+      k *= BIG_CONSTANT(0xc4ceb9fe1a85ec53);
+      k ^= k >> 33;
+      return k;
+    }
+
     static void murmur_hash3_x86_32(const void* key, int len, uint32_t seed, void* out) {
       const uint8_t * data = (const uint8_t*)key;
       const int nblocks = len / 4;
@@ -73,6 +87,48 @@ public:
       *(uint32_t*)out = h1;
     }
 
+    /** MurmurHash64A (from MurmurHash2): a 64-bit hash of a byte string
+     *  that consumes 8 bytes per step, for keys longer than a word.
+     */
+    static uint64_t murmur_hash64a(const void* key, size_t len, uint64_t seed) {
+      const uint64_t m = BIG_CONSTANT(0xc6a4a7935bd1e995);
+      const int r = 47;
+
+      const uint8_t * data = (const uint8_t*)key;
+      const uint8_t * end = data + (len & ~(size_t) 7);
+
+      uint64_t h = seed ^ (len * m);
+
+      for(; data != end; data += 8) {
+        uint64_t k;
+        memcpy(&k, data, sizeof(k));
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+      }
+
+      switch(len & 7) {
+      case 7: h ^= uint64_t(data[6]) << 48;
+      case 6: h ^= uint64_t(data[5]) << 40;
+      case 5: h ^= uint64_t(data[4]) << 32;
+      case 4: h ^= uint64_t(data[3]) << 24;
+      case 3: h ^= uint64_t(data[2]) << 16;
+      case 2: h ^= uint64_t(data[1]) << 8;
+      case 1: h ^= uint64_t(data[0]);
+              h *= m;
+      };
+
+      h ^= h >> r;
+      h *= m;
+      h ^= h >> r;
+
+      return h;
+    }
+
 };
 
 }
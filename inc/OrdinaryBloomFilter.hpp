@@ -1,61 +1,94 @@
 #ifndef OrdinaryBloomFilter_hpp
 #define OrdinaryBloomFilter_hpp
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
-#include "tensorflow/core/framework/tensor.h"
-#include "tensorflow/core/framework/tensor_types.h"
-#include "tensorflow/core/framework/op.h"
-#include "tensorflow/core/framework/op_kernel.h"
 #include "AbstractBloomFilter.hpp"
+#include "BitArrayCodec.hpp"
 #include "MurmurHash.hpp"
 
 // forward decl
 namespace bloom {
-    template <typename T>
+    template <typename T, typename Alloc = std::allocator<unsigned char>>
     class OrdinaryBloomFilter;
+
+    /** Arrangement of the hashes over an OrdinaryBloomFilter's bit array.
+     */
+    enum class Layout : uint8_t {
+        Standard = 0,       //!< Every hash addresses the whole array
+        Partitioned = 1     //!< Hash i only addresses slice i of k equal slices
+    };
 }
 
 #include "CountingBloomFilter.hpp"
 #include "PairedBloomFilter.hpp"
 
 
-using namespace tensorflow;
-
-namespace std {
-    template<>
-    struct hash<bloom::HashParams<uint32_t>> {
-        size_t operator()(bloom::HashParams<uint32_t> const &s) const {
-            uint32_t out;
-            bloom::MurmurHash3::murmur_hash3_x86_32((uint32_t*) &s.a, sizeof(s.a), s.b, (uint32_t*) &out);
-            return out;
-        }
-};
-}
 
 namespace bloom {
 
-    template <typename T>
+    /** An ordinary Bloom filter over a packed bit array.
+     *
+     *  With Layout::Partitioned the array is split into k byte-aligned slices
+     *  of numBytes / k bytes (any remainder is unused) and hash i sets bits
+     *  in slice i only. Every probe then lands in its own region, which can
+     *  be processed independently, the false positive ratio no longer
+     *  depends on probes colliding, and Compress folds each slice in place.
+     *  Conversions to counting and paired filters, and the TensorFlow
+     *  kernels, require Layout::Standard.
+     *
+     *  @param T     Contained type being indexed
+     *  @param Alloc Allocator for the bit array, e.g. LargePageAllocator for
+     *               huge-page or NUMA-aware placement of large filters
+     */
+    template <typename T, typename Alloc>
     class OrdinaryBloomFilter : public AbstractBloomFilter<T> {
 
     public:
 
+        /** Alloc rebound to another element type, for the arrays of converted BFs.
+         */
+        template <typename U>
+        using Rebind = typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+
         explicit
-        OrdinaryBloomFilter(uint8_t numHashes, size_t numBytes)
-                : AbstractBloomFilter<T>(numHashes, numBytes) {
+        OrdinaryBloomFilter(uint8_t numHashes, size_t numBytes, Alloc const& alloc = Alloc())
+                : AbstractBloomFilter<T>(numHashes, numBytes), m_layout(Layout::Standard), m_bitarray(alloc) {
+            m_bitarray.resize(numBytes, 0);
+        }
+
+        /** Constructor selecting the layout of the bit array. A partitioned
+         *  BF needs numBytes >= numHashes > 0, so that every slice holds at
+         *  least one byte.
+         *
+         *  @param layout Layout of the bit array
+         *  @throws std::invalid_argument if a partitioned BF would have
+         *          empty slices
+         */
+        OrdinaryBloomFilter(uint8_t numHashes, size_t numBytes, Layout layout, Alloc const& alloc = Alloc())
+                : AbstractBloomFilter<T>(numHashes, numBytes), m_layout(layout), m_bitarray(alloc) {
+            CheckSlices();
             m_bitarray.resize(numBytes, 0);
         }
 
         // Construct from bloom vector
-        OrdinaryBloomFilter(uint8_t numHashes, size_t numBytes, const int8_t* ptr)
-                : AbstractBloomFilter<T>(numHashes, numBytes) {
+        OrdinaryBloomFilter(uint8_t numHashes, size_t numBytes, const int8_t* ptr, Alloc const& alloc = Alloc())
+                : AbstractBloomFilter<T>(numHashes, numBytes), m_layout(Layout::Standard), m_bitarray(alloc) {
             m_bitarray.resize(numBytes);
             std::copy(ptr, ptr+numBytes, m_bitarray.begin());
         }
 
         virtual void Insert(T const& o) {
-            unsigned int bit_pos, value, prev, byte_pos;
+            unsigned int bit_pos, value, prev;
+            size_t byte_pos;
             for (uint8_t i = 0; i < super::GetNumHashes(); i++) {
-                size_t hash = super::ComputeHash(o, i) % (super::GetnumBytes()*8);
+                size_t hash = GetBitIndex(o, i);
                 byte_pos = hash/8;
                 bit_pos = hash%8;
                 prev = m_bitarray[byte_pos];
@@ -63,42 +96,193 @@ namespace bloom {
                 value = value << bit_pos;
                 value = value | prev;
                 m_bitarray[byte_pos] = value;
+                if (value != prev && !m_dirty.empty()) {
+                    MarkDirty(byte_pos / 8);
+                }
             }
         }
 
+        /** Queries whether an object is indexed by this Bloom filter. All k
+         *  positions are computed, then tested together without branching
+         *  on the bits.
+         *  @see bits::TestBits
+         */
         virtual bool Query(T const& o) const {
-            unsigned int bit_pos, value, prev, byte_pos;
-            for (uint8_t i = 0; i < super::GetNumHashes(); i++) {
-                size_t hash = super::ComputeHash(o, i) % (super::GetnumBytes()*8);
-                byte_pos = hash/8;
-                bit_pos = hash%8;
-                prev = m_bitarray[byte_pos];
-                value = 1;
-                value = value << bit_pos;
-                value = value | prev;
-                if (value != prev)
-                    return false;
+            const uint8_t numHashes = super::GetNumHashes();
+            size_t pos[256];
+            for (uint8_t i = 0; i < numHashes; i++) {
+                pos[i] = GetBitIndex(o, i);
+            }
+            return bits::TestBits(m_bitarray.data(), super::GetnumBytes(), pos, numHashes);
+        }
+
+        /** Queries a sequence of objects using a software pipeline. The probe
+         *  positions of up to QueryPipelineDepth objects are computed and
+         *  prefetched ahead of the object being resolved, so the cache misses
+         *  of consecutive lookups overlap instead of stalling one at a time.
+         *  Results are identical to calling Query on each object in order.
+         *
+         *  @param first Iterator to the first object to query
+         *  @param last  Iterator past the last object to query
+         *  @param cb    Invoked as cb(o, result) for each object, in order
+         */
+        template <typename ForwardIt, typename Callback>
+        void QueryStream(ForwardIt first, ForwardIt last, Callback cb) const {
+            const uint8_t numHashes = super::GetNumHashes();
+            const size_t depth = QueryPipelineDepth;
+            std::vector<size_t> ring(depth * numHashes);
+            std::vector<ForwardIt> pending(depth, first);
+            size_t issued = 0, resolved = 0;
+
+            while (first != last || resolved < issued) {
+                if (first != last && issued - resolved < depth) {
+                    size_t slot = issued % depth;
+                    size_t *pos = &ring[slot * numHashes];
+                    for (uint8_t i = 0; i < numHashes; i++) {
+                        pos[i] = GetBitIndex(*first, i);
+                        PrefetchRead(&m_bitarray[pos[i] / 8]);
+                    }
+                    pending[slot] = first;
+                    ++first;
+                    ++issued;
+                    continue;
+                }
+
+                size_t slot = resolved % depth;
+                const size_t *pos = &ring[slot * numHashes];
+                cb(*pending[slot], bits::TestBits(m_bitarray.data(), super::GetnumBytes(), pos, numHashes));
+                ++resolved;
+            }
+        }
+
+        /** Queries an array of objects through the pipelined path.
+         *  @see QueryStream
+         *
+         *  @param keys    Objects to query
+         *  @param n       Number of objects
+         *  @param results Output array of n query results
+         */
+        void QueryBatch(T const* keys, size_t n, bool* results) const {
+            QueryStream(keys, keys + n, [&results](T const&, bool present) {
+                *results++ = present;
+            });
+        }
+
+        /** Returns the bit probed by the i-th hash of an object.
+         *
+         *  @param o Object to hash
+         *  @param i Index of the hash function
+         *  @return  Bit index in [0, numBytes * 8)
+         */
+        size_t GetBitIndex(T const& o, uint8_t i) const {
+            return BitIndexFromHash(super::ComputeHash(o, i), i);
+        }
+
+        /** Returns the bit probed by the i-th hash given the hash value, for
+         *  callers that reuse one ComputeHash result across several filters.
+         *
+         *  @param hash ComputeHash(o, i)
+         *  @param i    Index of the hash function
+         *  @return     Bit index in [0, numBytes * 8)
+         */
+        size_t BitIndexFromHash(size_t hash, uint8_t i) const {
+            if (m_layout == Layout::Partitioned) {
+                size_t sliceBits = 8 * GetSliceBytes();
+                return i * sliceBits + hash % sliceBits;
+            }
+            return hash % GetNumBits();
+        }
+
+        Layout GetLayout() const {
+            return m_layout;
+        }
+
+        /** Returns the size of each slice: numBytes / numHashes for a
+         *  partitioned BF, the whole array otherwise. Slice i starts at byte
+         *  i * GetSliceBytes().
+         */
+        size_t GetSliceBytes() const {
+            if (m_layout == Layout::Partitioned) {
+                return super::GetnumBytes() / super::GetNumHashes();
             }
-            return true;
+            return super::GetnumBytes();
         }
 
-        std::string Hash(T const& o) {
+        /** Returns the bit probed by the i-th hash of an object in any standard
+         *  layout filter of the given size, for code that works on raw bit
+         *  arrays (such as the TensorFlow kernels) without an
+         *  OrdinaryBloomFilter instance.
+         *
+         *  @param o        Object to hash
+         *  @param i        Index of the hash function
+         *  @param numBytes Size of the bit array
+         *  @return         Bit index in [0, numBytes * 8)
+         */
+        static size_t BitIndex(T const& o, uint8_t i, size_t numBytes) {
+            return super::ComputeHash(o, i) % (numBytes*8);
+        }
+
+        /** Returns the sorted probe positions of an object concatenated as
+         *  decimal strings. Prefer HashPositions or HashFingerprint, which do
+         *  not allocate.
+         */
+        std::string Hash(T const& o) const {
+            size_t hashes[256];
+            HashPositions(o, hashes);
             std::string hash_string = "";
-            std::vector<size_t> hashes;
             for (uint8_t i = 0; i < super::GetNumHashes(); i++) {
-                size_t hash = super::ComputeHash(o, i) % (super::GetnumBytes()*8);
-                hashes.push_back(hash);
-            }
-            std::sort(hashes.begin(), hashes.end());
-            for (int i=0; i < hashes.size() ; i++) {
                 hash_string += std::to_string(hashes[i]);
-//                std::cout << "  hash: " << hash_string <<std::endl;
             }
             return hash_string;
         }
 
+        /** Writes the probe positions of an object in ascending order.
+         *
+         *  @param o   Object to hash
+         *  @param out Array receiving GetNumHashes() positions
+         */
+        void HashPositions(T const& o, size_t* out) const {
+            const uint8_t numHashes = super::GetNumHashes();
+            for (uint8_t i = 0; i < numHashes; i++) {
+                size_t pos = GetBitIndex(o, i);
+                uint8_t j = i;
+                for (; j > 0 && out[j-1] > pos; j--) {
+                    out[j] = out[j-1];
+                }
+                out[j] = pos;
+            }
+        }
+
+        /** Returns a 64-bit fingerprint of the multiset of probe positions of
+         *  an object. Objects probing the same positions share a fingerprint;
+         *  other objects collide with probability about 2^-64. The positions
+         *  are combined order-independently, so no sorting is needed.
+         *
+         *  @param o Object to hash
+         *  @return  Fingerprint of the object's probe positions
+         */
+        uint64_t HashFingerprint(T const& o) const {
+            uint64_t fp = super::GetNumHashes();
+            for (uint8_t i = 0; i < super::GetNumHashes(); i++) {
+                fp += MurmurHash3::fmix64(GetBitIndex(o, i) + 1);
+            }
+            return MurmurHash3::fmix64(fp);
+        }
+
+        /** Computes HashFingerprint for an array of objects.
+         *
+         *  @param keys Objects to hash
+         *  @param n    Number of objects
+         *  @param out  Output array of n fingerprints
+         */
+        void HashFingerprintBatch(T const* keys, size_t n, uint64_t* out) const {
+            for (size_t j = 0; j < n; j++) {
+                out[j] = HashFingerprint(keys[j]);
+            }
+        }
+
         int Get_Hash(T const& o, uint8_t i) {
-                return super::ComputeHash(o, i) % (super::GetnumBytes()*8);
+                return GetBitIndex(o, i);
         }
 
         uint8_t Get_numHashes() {
@@ -109,25 +293,33 @@ namespace bloom {
                 return super::GetnumBytes();
         }
 
-        int find(const Tensor& indices, int x) {
-            auto indices_flat = indices.flat<int>();
-            for (int i=0; i<indices_flat.size(); ++i) {   // Dummy lookup
-                if (indices_flat(i) == x)
-                    return 1;
-            }
-        return 0;
-    }
-
-        int Compute_False_Positives(int N, const Tensor& indices) {
+        /** Counts the false positives of this filter over the universe of
+         *  indices [0, N), given the indices that were actually inserted.
+         *  For TensorFlow tensors of indices, see TensorflowAdapter.hpp.
+         *
+         *  @param N       Size of the universe
+         *  @param indices Inserted indices
+         *  @param n       Number of inserted indices
+         *  @return        Number of indices that query true but were not inserted
+         */
+        int Compute_False_Positives(int N, const int* indices, size_t n) const {
+            std::vector<int> inserted(indices, indices + n);
+            std::sort(inserted.begin(), inserted.end());
             int false_positives = 0;
             for (int i=0; i<N; ++i) {
-                if (Query(i) && !find(indices, i)) {
+                if (Query(i) && !std::binary_search(inserted.begin(), inserted.end(), i)) {
                     false_positives++;
                 }
             }
             return false_positives;
         }
 
+        /** Returns the size of the bit array in bits.
+         */
+        size_t GetNumBits() const {
+            return super::GetnumBytes()*8;
+        }
+
         void fprint(FILE* f) {
             unsigned int bit_pos, byte_pos, value, byte;
             fprintf(f, "Bloom Filter: \n [ ");
@@ -166,103 +358,606 @@ namespace bloom {
         }
 
 
+        /** Serializes this Bloom filter into the given output stream: the
+         *  number of hashes (uint8_t), the size (size_t) and the bit array.
+         *  A partitioned layout is recorded in the most significant bit of the
+         *  size, so standard filters keep their original format.
+         *
+         *  @param os output stream to serialize the BF into
+         */
         virtual void Serialize(std::ostream &os) const {
             uint8_t numHashes = super::GetNumHashes();
             size_t numBytes = super::GetnumBytes();
+            size_t header = HeaderSize();
 
             os.write((const char *) &numHashes, sizeof(uint8_t));
-            os.write((const char *) &numBytes, sizeof(size_t));
+            os.write((const char *) &header, sizeof(size_t));
+            os.write((const char *) m_bitarray.data(), numBytes);
+        }
 
-            for(size_t i = 0; i < (numBytes + 7) / 8; i++){
-                uint8_t byte = 0;
-                for(size_t j = 0; j < 8 && (i + j) < numBytes; j++){
-                    byte = (byte << 1) | m_bitarray[8*i+j];
-                }
-                os.write((const char *) &byte, sizeof(uint8_t));
-            }
+        /** Serializes this Bloom filter with its bit array compactly encoded,
+         *  which is much smaller than Serialize for sparse filters.
+         *  @see BitArrayCodec
+         *
+         *  @param os output stream to serialize the BF into
+         *  @return   Encoding chosen for the bit array
+         */
+        Encoding SerializeEncoded(std::ostream &os) const {
+            uint8_t numHashes = super::GetNumHashes();
+            size_t numBytes = super::GetnumBytes();
+            size_t header = HeaderSize();
+
+            os.write((const char *) &numHashes, sizeof(uint8_t));
+            os.write((const char *) &header, sizeof(size_t));
+            return BitArrayCodec::Encode(m_bitarray.data(), numBytes, os);
         }
 
-        std::vector<unsigned char>& Get_bloom() {
+        std::vector<unsigned char, Alloc>& Get_bloom() {
             return m_bitarray;
         }
 
+        /** Returns the raw bit array, GetnumBytes() bytes long.
+         */
+        const unsigned char* Data() const {
+            return m_bitarray.data();
+        }
+
         /** Create an OrdinaryBloomFilter from the content of a binary input
-         * stream. No validation is performed.
+         * stream. Only the shape is validated.
          *
-         * @param  is Input stream to read from
+         * @param  is    Input stream to read from
+         * @param  alloc Allocator for the bit array of the result
          * @return Deserialized OrdinaryBloomFilter
+         * @throws std::invalid_argument if the header gives a partitioned BF
+         *         with empty slices
          */
-        static OrdinaryBloomFilter<T> Deserialize(std::istream &is){
+        static OrdinaryBloomFilter Deserialize(std::istream &is, Alloc const& alloc = Alloc()){
             uint8_t numHashes;
             size_t numBytes;
 
             is.read((char *) &numHashes, sizeof(uint8_t));
             is.read((char *) &numBytes, sizeof(size_t));
 
-            OrdinaryBloomFilter<T> r (numHashes, numBytes);
+            OrdinaryBloomFilter r (numHashes, numBytes & ~PartitionedFlag, HeaderLayout(numBytes), alloc);
+            numBytes &= ~PartitionedFlag;
+            is.read((char *) r.m_bitarray.data(), numBytes);
 
-            for(size_t i = 0; i < (numBytes + 7) / 8; i++){
-                uint8_t byte;
-                is.read((char *) &byte, sizeof(uint8_t));
-                for(size_t j = 0; j < 8 && (i + j) < numBytes; j++){
-                    r.m_bitarray[8 * i + j] = byte & (1 << (7-j));
-                }
-            }
+            return r;
+        }
+
+        /** Create an OrdinaryBloomFilter from the output of SerializeEncoded.
+         *  The bit array is decoded directly into the new filter's storage.
+         *  Only the shape is validated.
+         *
+         * @param  is    Input stream to read from
+         * @param  alloc Allocator for the bit array of the result
+         * @return Deserialized OrdinaryBloomFilter
+         * @throws std::invalid_argument if the header gives a partitioned BF
+         *         with empty slices
+         */
+        static OrdinaryBloomFilter DeserializeEncoded(std::istream &is, Alloc const& alloc = Alloc()){
+            uint8_t numHashes;
+            size_t numBytes;
+
+            is.read((char *) &numHashes, sizeof(uint8_t));
+            is.read((char *) &numBytes, sizeof(size_t));
 
+            OrdinaryBloomFilter r (numHashes, numBytes & ~PartitionedFlag, HeaderLayout(numBytes), alloc);
+            numBytes &= ~PartitionedFlag;
+            BitArrayCodec::Decode(is, r.m_bitarray.data(), numBytes);
             return r;
         }
 
         /** Halves this OrdinaryBloomFilter, reducing its size at the cost of an
-         *  increased false positive ratio.
+         *  increased false positive ratio. A partitioned BF is folded slice by
+         *  slice. The size (of a slice, if partitioned) should be even.
          *
          *  @return A new OrdinaryBloomFilter with half as many bits.
          */
-        OrdinaryBloomFilter<T> Compress() const {
-            size_t oldnumBytes = super::GetnumBytes();
-            size_t newnumBytes = oldnumBytes / 2;
+        OrdinaryBloomFilter Compress() const {
+            OrdinaryBloomFilter res(super::GetNumHashes(), FoldedBytes(2), m_layout, m_bitarray.get_allocator());
+            FoldRange(res.m_bitarray.data(), 0, res.GetnumBytes(), 2);
+            return res;
+        }
 
-            OrdinaryBloomFilter<T> res(super::GetNumHashes(), newnumBytes);
+        /** Writes the serialization of this BF shrunk by the given factor in
+         *  one streaming pass: for factor 2 the output is that of
+         *  Compress().Serialize(os), or Compress().SerializeEncoded(os) if
+         *  encoded, but no compressed BF is allocated. The factor should
+         *  divide the size (of a slice, if partitioned).
+         *
+         *  @param os      output stream to serialize the BF into
+         *  @param factor  Number of times to fold the bit array
+         *  @param encoded Whether to encode the bit array as SerializeEncoded
+         *  @return        Encoding chosen for the bit array
+         */
+        Encoding SerializeCompressed(std::ostream &os, size_t factor = 2, bool encoded = false) const {
+            return SerializeCompressedChunks([&os](const unsigned char *data, size_t n) {
+                os.write((const char *) data, n);
+            }, factor, encoded);
+        }
 
-            for(size_t i = 0; i < oldnumBytes; i++){
-                res.m_bitarray[i % newnumBytes] = res.m_bitarray[i % newnumBytes] | m_bitarray[i];
+        /** As SerializeCompressed, but hands the output to a sink in chunks
+         *  of up to about BitArrayCodec::BlockBytes as they are produced, so
+         *  that they can be copied into a caller's buffer or sent while the
+         *  rest is being folded.
+         *
+         *  @param sink    Called as sink(data, n) with consecutive chunks
+         *  @param factor  Number of times to fold the bit array
+         *  @param encoded Whether to encode the bit array as SerializeEncoded
+         *  @return        Encoding chosen for the bit array
+         */
+        template <typename Sink>
+        Encoding SerializeCompressedChunks(Sink sink, size_t factor = 2, bool encoded = false) const {
+            uint8_t numHashes = super::GetNumHashes();
+            size_t numBytes = FoldedBytes(factor);
+            size_t header = numBytes | (m_layout == Layout::Partitioned ? PartitionedFlag : 0);
+
+            unsigned char head[sizeof(uint8_t) + sizeof(size_t)];
+            head[0] = numHashes;
+            std::memcpy(head + 1, &header, sizeof(size_t));
+            sink((const unsigned char *) head, sizeof(head));
+
+            auto fill = [this, factor](unsigned char *out, size_t offset, size_t n) {
+                FoldRange(out, offset, n, factor);
+            };
+            if (encoded) {
+                return BitArrayCodec::EncodeBlocks(fill, numBytes, sink);
             }
 
-            return res;
+            const size_t blockBytes = BitArrayCodec::BlockBytes;
+            std::vector<unsigned char> block(std::min(numBytes, blockBytes));
+            for (size_t offset = 0; offset < numBytes; offset += block.size()) {
+                size_t n = std::min(block.size(), numBytes - offset);
+                fill(block.data(), offset, n);
+                sink((const unsigned char *) block.data(), n);
+            }
+            return Encoding::Raw;
         }
 
         /** Creates a PairedBloomFilter with an empty negative set, and a positive
-         *  set given by this OrdinaryBloomFilter.
+         *  set given by this OrdinaryBloomFilter, which must use
+         *  Layout::Standard.
          *
-         *  @return A new PairedBloomFilter
+         *  @return A new PairedBloomFilter, allocating from this BF's allocator
          */
-        PairedBloomFilter<T> ToPairedBloomFilter() const {
+        PairedBloomFilter<T, Rebind<unsigned char>> ToPairedBloomFilter() const {
+            PairedBloomFilter<T, Rebind<unsigned char>> res(super::GetNumHashes(), 0, m_bitarray.get_allocator());
+            ToPaired(res);
+            return res;
+        }
+
+        /** Overwrites a PairedBloomFilter with the one ToPairedBloomFilter
+         *  would return, reusing its storage when large enough.
+         *
+         *  @param out Destination BF
+         *  @throws std::invalid_argument if this BF is partitioned
+         */
+        template <typename A>
+        void ToPaired(PairedBloomFilter<T, A>& out) const {
+            CheckStandard("ToPaired");
             size_t numBytes = super::GetnumBytes();
-            PairedBloomFilter<T> res(super::GetNumHashes(), numBytes);
-            for(size_t i = 0; i < numBytes; i++){
-                res.m_bitarray[i] = m_bitarray[i];
-            }
+            out.Reshape(super::GetNumHashes(), GetNumBits());
+            std::copy(m_bitarray.begin(), m_bitarray.end(), out.m_bitarray.begin());
+            std::fill(out.m_bitarray.begin() + numBytes, out.m_bitarray.end(), 0);
+        }
+
+        /** Creates a CountingBloomFilter whose counters are 1 for each set bit
+         *  of this BF, so that it answers queries identically. Objects that
+         *  shared bits when inserted here cannot all be deleted from it
+         *  without false negatives. This BF must use Layout::Standard.
+         *
+         *  @return A new CountingBloomFilter, allocating from this BF's allocator
+         */
+        CountingBloomFilter<T, Rebind<uint8_t>> ToCountingBloomFilter() const {
+            CountingBloomFilter<T, Rebind<uint8_t>> res(super::GetNumHashes(), 0, m_bitarray.get_allocator());
+            ToCounting(res);
             return res;
         }
 
+        /** Overwrites a CountingBloomFilter with the one ToCountingBloomFilter
+         *  would return, reusing its storage when large enough.
+         *
+         *  @param out Destination BF
+         *  @throws std::invalid_argument if this BF is partitioned
+         */
+        template <typename A>
+        void ToCounting(CountingBloomFilter<T, A>& out) const {
+            CheckStandard("ToCounting");
+            out.Reshape(super::GetNumHashes(), GetNumBits());
+            bits::UnpackBits(m_bitarray.data(), GetNumBits(), out.m_bitarray.data());
+            out.MarkAllDirty();
+        }
+
+        /** Empties this BF and gives it a new shape, reusing the storage when
+         *  it is large enough. The layout and change tracking are kept.
+         *
+         *  @param numHashes Number of hashes per object
+         *  @param numBytes  Size of the bit array
+         *  @throws std::invalid_argument if a partitioned BF would have
+         *          empty slices
+         */
+        void Reset(uint8_t numHashes, size_t numBytes){
+            Reshape(numHashes, numBytes);
+            CheckSlices();
+            Clear();
+        }
+
         /** Update this Bloom filter by adding the contents of a second one.
          *  The BFs will be combined by logical OR, thus new false positives may be
          *  introduced.
          *
-         *  @param other BF to combine into this one
+         *  @param other BF to combine into this one; may use another allocator
+         */
+        template <typename A>
+        void Union(OrdinaryBloomFilter<T, A> const& other){
+            CheckSameShape(other, "Union");
+            bits::Combine(m_bitarray.data(), other.Data(), super::GetnumBytes(), bits::OrOp());
+            MarkAllDirty();
+        }
+
+        /** Update this Bloom filter to the intersection with a second one of
+         *  the same size, by logical AND. Every object present in both is
+         *  still found; the false positive ratio is at least that of a BF
+         *  built from the intersection directly.
+         *
+         *  @param other BF to intersect with this one
+         */
+        template <typename A>
+        void Intersect(OrdinaryBloomFilter<T, A> const& other){
+            CheckSameShape(other, "Intersect");
+            bits::Combine(m_bitarray.data(), other.Data(), super::GetnumBytes(), bits::AndOp());
+            MarkAllDirty();
+        }
+
+        /** Update this Bloom filter by clearing the bits set in a second one
+         *  of the same size (A AND NOT B). Unlike Union and Intersect this
+         *  may introduce false negatives for objects of this BF sharing a bit
+         *  with the other; it is meant for comparing bit patterns rather
+         *  than as an exact set difference.
+         *
+         *  @param other BF whose bits to remove from this one
+         */
+        template <typename A>
+        void Difference(OrdinaryBloomFilter<T, A> const& other){
+            CheckSameShape(other, "Difference");
+            bits::Combine(m_bitarray.data(), other.Data(), super::GetnumBytes(), bits::AndNotOp());
+            MarkAllDirty();
+        }
+
+        /** Returns the number of set bits.
+         */
+        size_t CountBits() const {
+            return bits::CountBits(m_bitarray.data(), super::GetnumBytes());
+        }
+
+        /** Returns the number of bits set in both this and another BF of the
+         *  same size, without building the intersection.
+         */
+        template <typename A>
+        size_t IntersectCount(OrdinaryBloomFilter<T, A> const& other) const {
+            CheckSameShape(other, "IntersectCount");
+            return bits::CountCombined(m_bitarray.data(), other.Data(), super::GetnumBytes(), bits::AndOp());
+        }
+
+        /** Returns the number of bits set in this BF but not in another of the
+         *  same size, without building the difference.
+         */
+        template <typename A>
+        size_t DifferenceCount(OrdinaryBloomFilter<T, A> const& other) const {
+            CheckSameShape(other, "DifferenceCount");
+            return bits::CountCombined(m_bitarray.data(), other.Data(), super::GetnumBytes(), bits::AndNotOp());
+        }
+
+        /** Returns the number of bits set in this or another BF of the same
+         *  size, without building the union.
+         */
+        template <typename A>
+        size_t UnionCount(OrdinaryBloomFilter<T, A> const& other) const {
+            CheckSameShape(other, "UnionCount");
+            return bits::CountCombined(m_bitarray.data(), other.Data(), super::GetnumBytes(), bits::OrOp());
+        }
+
+        /** Estimates the number of distinct objects inserted into a BF of
+         *  this shape with the given number of set bits (Swamidass & Baldi).
+         *
+         *  @param setBits Number of set bits
+         *  @return        Estimated number of objects
          */
-        void Union(OrdinaryBloomFilter<T> const& other){
-            for(size_t i = 0; i < super::GetnumBytes(); i++){
-                m_bitarray[i] = m_bitarray[i] | other.m_bitarray[i];
+        double EstimateCardinality(size_t setBits) const {
+            // Bytes past the last slice of a partitioned BF are never set.
+            size_t usedBits = m_layout == Layout::Partitioned
+                    ? 8 * GetSliceBytes() * super::GetNumHashes() : GetNumBits();
+            double m = (double) usedBits;
+            if (setBits >= usedBits) {
+                setBits = usedBits - 1;
+            }
+            return -m / super::GetNumHashes() * std::log1p(-(double) setBits / m);
+        }
+
+        /** Estimates the Jaccard similarity of the sets indexed by this and
+         *  another BF of the same shape, from the cardinalities of both
+         *  filters and of their union, all derived from popcounts.
+         *
+         *  @param other BF to compare with
+         *  @return      Estimate of |A n B| / |A u B| in [0, 1]
+         */
+        template <typename A>
+        double Jaccard(OrdinaryBloomFilter<T, A> const& other) const {
+            double a = EstimateCardinality(CountBits());
+            double b = EstimateCardinality(other.CountBits());
+            double u = EstimateCardinality(UnionCount(other));
+            if (u <= 0) {
+                return 1.0;
+            }
+            double j = (a + b - u) / u;
+            return j < 0 ? 0.0 : (j > 1 ? 1.0 : j);
+        }
+
+        /** Removes all objects from this Bloom filter, keeping its storage.
+         *  Large arrays are zeroed with non-temporal stores.
+         */
+        void Clear(){
+            bits::ZeroFill(m_bitarray.data(), m_bitarray.size());
+            MarkAllDirty();
+        }
+
+        /** Starts or stops tracking which 64-bit words of the bit array change.
+         *  While tracking, Insert marks each word whose bits it newly sets,
+         *  and bulk operations (Union, Intersect, ...) mark every word, so
+         *  SerializeDelta needs no scan of the array. Starting tracking
+         *  clears the set of changed words.
+         *
+         *  @param enable Whether to track changes
+         */
+        void TrackChanges(bool enable){
+            m_dirty.assign(enable ? (NumWords() + 63) / 64 : 0, 0);
+        }
+
+        /** Writes the words changed since tracking started or since the last
+         *  call, then forgets them. Applying the output with ApplyDelta to a
+         *  copy of the filter as it was at that point brings it up to date.
+         *  Tracking must be enabled.
+         *  @see TrackChanges
+         *
+         *  @param os output stream to serialize the delta into
+         *  @return   Number of changed words written
+         */
+        size_t SerializeDelta(std::ostream &os){
+            std::vector<size_t> changed;
+            for (size_t d = 0; d < m_dirty.size(); d++) {
+                for (uint64_t w = m_dirty[d]; w != 0; w &= w - 1) {
+                    changed.push_back(64 * d + bits::CountTrailingZeros(w));
+                }
+                m_dirty[d] = 0;
+            }
+            WriteDelta(os, changed);
+            return changed.size();
+        }
+
+        /** Writes the words of this filter that differ from a previous
+         *  version of the same shape, found by a full comparison. Applying
+         *  the output with ApplyDelta to prev makes it equal to this filter.
+         *
+         *  @param prev Previous version of this filter
+         *  @param os   output stream to serialize the delta into
+         *  @return     Number of changed words written
+         *  @throws std::invalid_argument if prev differs in size or layout
+         */
+        template <typename A>
+        size_t SerializeDelta(OrdinaryBloomFilter<T, A> const& prev, std::ostream &os) const {
+            CheckSameShape(prev, "SerializeDelta");
+            std::vector<size_t> changed;
+            for (size_t w = 0; w < NumWords(); w++) {
+                if (LoadWordAt(m_bitarray.data(), w) != LoadWordAt(prev.Data(), w)) {
+                    changed.push_back(w);
+                }
+            }
+            WriteDelta(os, changed);
+            return changed.size();
+        }
+
+        /** Updates this filter in place from the output of SerializeDelta.
+         *  Only the changed words are touched; they are marked changed if
+         *  tracking is enabled here as well. The whole delta is read and
+         *  checked before any word is written, so a rejected delta leaves
+         *  this filter unchanged.
+         *
+         *  @param is Input stream to read from
+         *  @throws std::invalid_argument if the delta was written by a filter
+         *          of another shape, names a word outside the array or is
+         *          truncated
+         */
+        void ApplyDelta(std::istream &is){
+            uint8_t numHashes;
+            size_t header;
+            uint64_t count;
+
+            is.read((char *) &numHashes, sizeof(uint8_t));
+            is.read((char *) &header, sizeof(size_t));
+            is.read((char *) &count, sizeof(uint64_t));
+            if (!is || numHashes != super::GetNumHashes() || header != HeaderSize()) {
+                throw std::invalid_argument("OrdinaryBloomFilter::ApplyDelta: delta is for a BF of another shape");
+            }
+
+            std::vector<size_t> changed;
+            std::vector<unsigned char> words;
+            size_t w = 0;
+            for (uint64_t c = 0; c < count; c++) {
+                uint64_t gap = bits::ReadVarint(is);
+                if (gap >= NumWords() - w) {
+                    throw std::invalid_argument("OrdinaryBloomFilter::ApplyDelta: word index out of range");
+                }
+                w += gap;
+                size_t n = std::min<size_t>(8, super::GetnumBytes() - 8 * w);
+                words.resize(words.size() + n);
+                is.read((char *) words.data() + words.size() - n, n);
+                if (!is) {
+                    throw std::invalid_argument("OrdinaryBloomFilter::ApplyDelta: delta is truncated");
+                }
+                changed.push_back(w);
+                w++;
+            }
+
+            const unsigned char *word = words.data();
+            for (size_t c = 0; c < changed.size(); c++) {
+                size_t offset = 8 * changed[c];
+                size_t n = std::min<size_t>(8, super::GetnumBytes() - offset);
+                std::copy(word, word + n, m_bitarray.begin() + offset);
+                word += n;
+                if (!m_dirty.empty()) {
+                    MarkDirty(changed[c]);
+                }
             }
         }
 
-        friend OrdinaryBloomFilter<T> CountingBloomFilter<T>::ToOrdinaryBloomFilter() const;
+        template <typename U, typename A>
+        friend class CountingBloomFilter;
+
+        template <typename U, typename A>
+        friend class PairedBloomFilter;
+
+        /** Number of lookups kept in flight by QueryStream.
+         */
+        static const size_t QueryPipelineDepth = 16;
 
     private:
 
         typedef AbstractBloomFilter<T> super;
 
-        std::vector<unsigned char> m_bitarray;
+        /** Most significant bit of the serialized size, set for a partitioned
+         *  layout.
+         */
+        static const size_t PartitionedFlag = ~(~(size_t) 0 >> 1);
+
+        size_t HeaderSize() const {
+            return super::GetnumBytes() | (m_layout == Layout::Partitioned ? PartitionedFlag : 0);
+        }
+
+        static Layout HeaderLayout(size_t header) {
+            return (header & PartitionedFlag) ? Layout::Partitioned : Layout::Standard;
+        }
+
+        /** Size of this BF folded factor times, slice by slice if partitioned.
+         */
+        size_t FoldedBytes(size_t factor) const {
+            size_t slice = GetSliceBytes() / factor;
+            return m_layout == Layout::Partitioned ? slice * super::GetNumHashes() : slice;
+        }
+
+        /** Writes bytes [offset, offset + n) of this BF folded factor times.
+         *  Byte i of the folded array (or slice) is the OR of every byte of
+         *  the array (or slice) at an index congruent to i modulo its folded
+         *  size.
+         */
+        void FoldRange(unsigned char *out, size_t offset, size_t n, size_t factor) const {
+            size_t sliceBytes = GetSliceBytes();
+            size_t foldedSlice = sliceBytes / factor;
+            while (n > 0) {
+                size_t i = offset % foldedSlice;
+                size_t len = std::min(n, foldedSlice - i);
+                const unsigned char *src = m_bitarray.data() + (offset / foldedSlice) * sliceBytes;
+                std::copy(src + i, src + i + len, out);
+                for (size_t at = i + foldedSlice; at < sliceBytes; at += foldedSlice) {
+                    bits::Combine(out, src + at, std::min(len, sliceBytes - at), bits::OrOp());
+                }
+                out += len;
+                offset += len;
+                n -= len;
+            }
+        }
+
+        /** Resizes the storage for a new shape without clearing it.
+         */
+        void Reshape(uint8_t numHashes, size_t numBytes) {
+            super::SetShape(numHashes, numBytes);
+            m_bitarray.resize(numBytes);
+            if (!m_dirty.empty()) {
+                TrackChanges(true);
+            }
+        }
+
+        /** Throws if this BF is partitioned into slices of zero bytes, on
+         *  which every probe would divide by zero.
+         */
+        void CheckSlices() const {
+            if (m_layout == Layout::Partitioned
+                && (super::GetNumHashes() == 0 || super::GetnumBytes() < super::GetNumHashes())) {
+                throw std::invalid_argument("OrdinaryBloomFilter: a partitioned BF needs numBytes >= numHashes > 0");
+            }
+        }
+
+        /** Throws unless this BF uses Layout::Standard, for operations that
+         *  map bit i of the array to slot i of another filter type.
+         */
+        void CheckStandard(const char *op) const {
+            if (m_layout != Layout::Standard) {
+                throw std::invalid_argument(std::string("OrdinaryBloomFilter::") + op + ": BF is partitioned");
+            }
+        }
+
+        /** Throws unless another BF probes the same bits for every object:
+         *  same size and layout, and same number of slices if partitioned.
+         */
+        template <typename A>
+        void CheckSameShape(OrdinaryBloomFilter<T, A> const& other, const char *op) const {
+            if (other.GetnumBytes() != super::GetnumBytes() || other.GetLayout() != m_layout
+                || (m_layout == Layout::Partitioned && other.GetNumHashes() != super::GetNumHashes())) {
+                throw std::invalid_argument(std::string("OrdinaryBloomFilter::") + op + ": BFs differ in size or layout");
+            }
+        }
+
+        size_t NumWords() const {
+            return (super::GetnumBytes() + 7) / 8;
+        }
+
+        uint64_t LoadWordAt(const unsigned char *bitarray, size_t w) const {
+            size_t n = super::GetnumBytes() - 8 * w;
+            return n >= 8 ? bits::LoadWord(bitarray + 8 * w) : bits::LoadPartialWord(bitarray + 8 * w, n);
+        }
+
+        void MarkDirty(size_t word) {
+            m_dirty[word / 64] |= 1ULL << (word % 64);
+        }
+
+        void MarkAllDirty() {
+            std::fill(m_dirty.begin(), m_dirty.end(), ~0ULL);
+            if (!m_dirty.empty() && NumWords() % 64 != 0) {
+                m_dirty.back() = (1ULL << (NumWords() % 64)) - 1;
+            }
+        }
+
+        /** Delta format: numHashes and numBytes as in Serialize, the number
+         *  of changed words (uint64_t), then for each word in ascending order
+         *  the varint gap from the previous word and its bytes.
+         */
+        void WriteDelta(std::ostream &os, std::vector<size_t> const& changed) const {
+            uint8_t numHashes = super::GetNumHashes();
+            size_t numBytes = super::GetnumBytes();
+            size_t header = HeaderSize();
+            uint64_t count = changed.size();
+
+            os.write((const char *) &numHashes, sizeof(uint8_t));
+            os.write((const char *) &header, sizeof(size_t));
+            os.write((const char *) &count, sizeof(uint64_t));
+
+            size_t next = 0;
+            for (size_t c = 0; c < changed.size(); c++) {
+                size_t offset = 8 * changed[c];
+                bits::WriteVarint(os, changed[c] - next);
+                os.write((const char *) m_bitarray.data() + offset,
+                         std::min<size_t>(8, numBytes - offset));
+                next = changed[c] + 1;
+            }
+        }
+
+        Layout m_layout;
+
+        std::vector<unsigned char, Alloc> m_bitarray;
+
+        /** One bit per 64-bit word of m_bitarray; empty when not tracking.
+         */
+        std::vector<uint64_t> m_dirty;
 
 
     }; // class OrdinaryBloomFilter
@@ -1,11 +1,15 @@
 #ifndef PairedBloomFilter_hpp
 #define PairedBloomFilter_hpp
 
+#include <algorithm>
+#include <memory>
+#include <vector>
 #include "AbstractDeletableBloomFilter.hpp"
+#include "BitOps.hpp"
 
 // forward decl
 namespace bloom {
-    template <typename T>
+    template <typename T, typename Alloc = std::allocator<unsigned char>>
     class PairedBloomFilter;
 }
 
@@ -19,9 +23,13 @@ namespace bloom {
  *  item is considered present if the query on the positive BF is positive and
  *  the query on the negative BF is negative.
  *
- *  @param T Contained type being indexed
+ *  Both halves are packed bit arrays laid out like OrdinaryBloomFilter's, the
+ *  negative half starting at the first byte after the positive one.
+ *
+ *  @param T     Contained type being indexed
+ *  @param Alloc Allocator for the bit array
  */
-template <typename T>
+template <typename T, typename Alloc>
 class PairedBloomFilter : public AbstractDeletableBloomFilter<T> {
 
 public:
@@ -30,18 +38,15 @@ public:
      *  @see AbstractBloomFilter::AbstractBloomFilter
      */
     explicit
-    PairedBloomFilter(uint8_t numHashes, uint16_t numBits)
-    : AbstractDeletableBloomFilter<T>(numHashes, numBits)
+    PairedBloomFilter(uint8_t numHashes, size_t numBits, Alloc const& alloc = Alloc())
+    : AbstractDeletableBloomFilter<T>(numHashes, numBits), m_bitarray(alloc)
     {
-        m_bitarray.reserve(numBits * 2);
-        for(uint16_t i = 0; i < super::GetNumBits() * 2; i++){
-            m_bitarray[i] = 0;
-        }
+        m_bitarray.resize(2 * HalfBytes(), 0);
     }
     
     virtual void Insert(T const& o) {
         for(uint8_t i = 0; i < super::GetNumHashes(); i++){
-            m_bitarray[super::ComputeHash(o, i)] = true;
+            SetBit(0, super::ComputeHash(o, i) % super::GetNumBits());
         }
     }
     
@@ -52,67 +57,66 @@ public:
      *  @return true if object is indexed, false if the object is not indexed.
      */
     virtual bool Query(T const& o) const {
-        for(uint8_t i = 0; i < super::GetNumHashes(); i++){
-            if(!m_bitarray[super::ComputeHash(o, i)]){
-                return false;
-            }
-        }
-        for(uint8_t i = 0; i < super::GetNumHashes(); i++){
-            if(!m_bitarray[super::GetNumBits() + super::ComputeHash(o, i)]){
-                return true;
-            }
+        const uint8_t numHashes = super::GetNumHashes();
+        size_t pos[256];
+        for(uint8_t i = 0; i < numHashes; i++){
+            pos[i] = super::ComputeHash(o, i) % super::GetNumBits();
         }
-        return false;
+        // Both halves are probed at the same positions and combined without
+        // branching on either result.
+        const unsigned char *positive = m_bitarray.data();
+        bool inserted = bits::TestBits(positive, HalfBytes(), pos, numHashes);
+        bool deleted = bits::TestBits(positive + HalfBytes(), HalfBytes(), pos, numHashes);
+        return inserted & !deleted;
     }
     
     virtual bool Delete(T const& o) {
         if(Query(o)){
             for(uint8_t i = 0; i < super::GetNumHashes(); i++){
-                m_bitarray[super::GetNumBits() + super::ComputeHash(o, i)] = true;
+                SetBit(HalfBytes(), super::ComputeHash(o, i) % super::GetNumBits());
             }
             return true;
         }
         return false;
     }
     
+    /** Serializes the number of hashes (uint8_t), the number of bits of
+     *  each half (uint64_t), then the positive and the negative bits as one
+     *  sequence, 8 per byte with the first bit in the most significant
+     *  position.
+     */
     virtual void Serialize(std::ostream &os) const {
         uint8_t numHashes = super::GetNumHashes();
-        uint16_t numBits = super::GetNumBits();
+        uint64_t numBits = super::GetNumBits();
 
         os.write((const char *) &numHashes, sizeof(uint8_t));
-        os.write((const char *) &numBits, sizeof(uint16_t));
+        os.write((const char *) &numBits, sizeof(uint64_t));
         
-        for(uint16_t i = 0; i < (2 * numBits + 7) / 8; i++){
-            uint8_t byte = 0;
-            for(int j = 0; j < 8 && (i + j) < 2 * numBits; j++){
-                byte = (byte << 1) | m_bitarray[8*i+j];
-            }
-            os.write((const char *) &byte, sizeof(uint8_t));
-        }
+        bits::MsbBitWriter out(os);
+        out.Append(m_bitarray.data(), numBits);
+        out.Append(m_bitarray.data() + HalfBytes(), numBits);
+        out.Flush();
     }
     
     /** Create a PairedBloomFilter from the content of a binary input
      *  stream. No validation is performed.
      *
-     *  @param  is Input stream to read from
+     *  @param  is    Input stream to read from
+     *  @param  alloc Allocator for the bit array of the result
      *  @return Deserialized PairedBloomFilter
      */
-    static PairedBloomFilter<T> Deserialize(std::istream &is){
+    static PairedBloomFilter Deserialize(std::istream &is, Alloc const& alloc = Alloc()){
         uint8_t numHashes;
-        uint16_t numBits;
+        uint64_t numBits;
         
         is.read((char *) &numHashes, sizeof(uint8_t));
-        is.read((char *) &numBits, sizeof(uint16_t));
+        is.read((char *) &numBits, sizeof(uint64_t));
         
-        PairedBloomFilter<T> r (numHashes, numBits);
+        PairedBloomFilter r (numHashes, numBits, alloc);
         
-        for(uint16_t i = 0; i < (2 * numBits + 7) / 8; i++){
-            uint8_t byte;
-            is.read((char *) &byte, sizeof(uint8_t));
-            for(int j = 0; j < 8 && (i + j) < 2 * numBits; j++){
-                r.m_bitarray[8 * i + j] = byte & (1 << (7-j));
-            }
-        }
+        bits::MsbBitReader in(is, (2 * numBits + 7) / 8);
+        in.Read(r.m_bitarray.data(), numBits);
+        in.Read(r.m_bitarray.data() + r.HalfBytes(), numBits);
         
         return r;
     }
@@ -124,23 +128,48 @@ public:
      *
      *  @param other new BF to combine into this one
      */
-    void Union(PairedBloomFilter<T> const& other){
-        uint16_t numBits = super::GetNumBits();
-        for(unsigned i = 0; i < numBits; i++){
-            m_bitarray[i] = m_bitarray[i] | other.m_bitarray[i];
-        }
-        for(unsigned i = 0; i < numBits; i++){
-            m_bitarray[numBits + i] = m_bitarray[numBits + i] & other.m_bitarray[numBits + i];
-        }
+    void Union(PairedBloomFilter const& other){
+        size_t half = HalfBytes();
+        bits::Combine(m_bitarray.data(), other.m_bitarray.data(), half, bits::OrOp());
+        bits::Combine(m_bitarray.data() + half, other.m_bitarray.data() + half, half, bits::AndOp());
     }
     
-    friend PairedBloomFilter<T> OrdinaryBloomFilter<T>::ToPairedBloomFilter() const;
+    /** Empties this BF and gives it a new shape, reusing the storage when
+     *  it is large enough.
+     *
+     *  @param numHashes Number of hashes per object
+     *  @param numBits   Number of bits of each half
+     */
+    void Reset(uint8_t numHashes, size_t numBits){
+        Reshape(numHashes, numBits);
+        std::fill(m_bitarray.begin(), m_bitarray.end(), 0);
+    }
+    
+    template <typename U, typename A>
+    friend class OrdinaryBloomFilter;
 
 private:
     
     typedef AbstractDeletableBloomFilter<T> super;
     
-    std::vector<bool> m_bitarray;
+    /** Bytes of each half of the bit array.
+     */
+    size_t HalfBytes() const {
+        return (super::GetNumBits() + 7) / 8;
+    }
+    
+    void SetBit(size_t offset, size_t i) {
+        m_bitarray[offset + i / 8] |= (unsigned char) (1u << (i % 8));
+    }
+    
+    /** Resizes the storage for a new shape without clearing it.
+     */
+    void Reshape(uint8_t numHashes, size_t numBits) {
+        super::SetShape(numHashes, numBits);
+        m_bitarray.resize(2 * HalfBytes());
+    }
+    
+    std::vector<unsigned char, Alloc> m_bitarray;
     
 
 }; // class PairedBloomFilter
@@ -0,0 +1,183 @@
+#ifndef PoolAllocator_hpp
+#define PoolAllocator_hpp
+
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace bloom {
+
+/** A thread-safe cache of freed bit arrays, keyed by their exact size.
+ *
+ *  Filters built and dropped once per step (by Compress, Deserialize, the
+ *  To*BloomFilter conversions, ...) keep asking for the same few sizes, so a
+ *  released array is kept and handed to the next request of that size
+ *  instead of going back to malloc. Recycled memory is already faulted in,
+ *  which also avoids the page faults of fresh large allocations.
+ *
+ *  The pool must outlive every container allocating from it.
+ */
+class BitArrayPool {
+
+public:
+
+    /** Constructor
+     *
+     *  @param maxCached Maximum number of free arrays kept; further releases
+     *                   are freed immediately
+     */
+    explicit
+    BitArrayPool(size_t maxCached = 256)
+    : m_numCached(0), m_maxCached(maxCached)
+    {}
+
+    ~BitArrayPool() {
+        Trim();
+    }
+
+    BitArrayPool(BitArrayPool const&) = delete;
+    BitArrayPool& operator=(BitArrayPool const&) = delete;
+
+    /** Returns a cache-line aligned block of the given size, recycled if
+     *  one is available. Its contents are unspecified.
+     */
+    void* Acquire(size_t bytes) {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            auto it = m_free.find(bytes);
+            if(it != m_free.end() && !it->second.empty()){
+                void *p = it->second.back();
+                it->second.pop_back();
+                m_numCached--;
+                return p;
+            }
+        }
+        void *p = nullptr;
+        if(posix_memalign(&p, Alignment, bytes ? bytes : 1) != 0){
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    /** Returns a block obtained from Acquire with the same size to the pool.
+     */
+    void Release(void *p, size_t bytes) {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            if(m_numCached < m_maxCached){
+                m_free[bytes].push_back(p);
+                m_numCached++;
+                return;
+            }
+        }
+        free(p);
+    }
+
+    /** Frees every cached block.
+     */
+    void Trim() {
+        std::lock_guard<std::mutex> guard(m_lock);
+        for(auto it = m_free.begin(); it != m_free.end(); ++it){
+            for(size_t i = 0; i < it->second.size(); i++){
+                free(it->second[i]);
+            }
+        }
+        m_free.clear();
+        m_numCached = 0;
+    }
+
+    /** Returns the number of free blocks currently cached.
+     */
+    size_t GetNumCached() const {
+        std::lock_guard<std::mutex> guard(m_lock);
+        return m_numCached;
+    }
+
+    /** Returns the process-wide pool used by default-constructed
+     *  PoolAllocators.
+     */
+    static BitArrayPool& Global() {
+        static BitArrayPool pool;
+        return pool;
+    }
+
+    static const size_t Alignment = 64;
+
+private:
+
+    mutable std::mutex m_lock;
+    std::unordered_map<size_t, std::vector<void*>> m_free;
+    size_t m_numCached;
+    size_t m_maxCached;
+
+}; // class BitArrayPool
+
+/** Allocator drawing from a BitArrayPool, for use as the Alloc parameter of
+ *  the BF classes, e.g.
+ *
+ *      OrdinaryBloomFilter<T, PoolAllocator<unsigned char>> bf(4, 1 << 20);
+ *
+ *  Conversions and Compress propagate the allocator, so the filters they
+ *  return recycle arrays from the same pool.
+ *
+ *  @param U Element type
+ */
+template <typename U>
+class PoolAllocator {
+
+public:
+
+    typedef U value_type;
+
+    /** Constructor
+     *
+     *  @param pool Pool to allocate from; defaults to BitArrayPool::Global()
+     */
+    PoolAllocator()
+    : m_pool(&BitArrayPool::Global())
+    {}
+
+    explicit
+    PoolAllocator(BitArrayPool &pool)
+    : m_pool(&pool)
+    {}
+
+    template <typename V>
+    PoolAllocator(PoolAllocator<V> const& other)
+    : m_pool(&other.GetPool())
+    {}
+
+    U* allocate(size_t n) {
+        return static_cast<U*>(m_pool->Acquire(n * sizeof(U)));
+    }
+
+    void deallocate(U* p, size_t n) {
+        m_pool->Release(p, n * sizeof(U));
+    }
+
+    BitArrayPool& GetPool() const {
+        return *m_pool;
+    }
+
+private:
+
+    BitArrayPool *m_pool;
+
+}; // class PoolAllocator
+
+template <typename U, typename V>
+bool operator==(PoolAllocator<U> const& a, PoolAllocator<V> const& b) {
+    return &a.GetPool() == &b.GetPool();
+}
+
+template <typename U, typename V>
+bool operator!=(PoolAllocator<U> const& a, PoolAllocator<V> const& b) {
+    return !(a == b);
+}
+
+} // namespace bloom
+
+#endif
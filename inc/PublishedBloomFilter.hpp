@@ -0,0 +1,257 @@
+#ifndef PublishedBloomFilter_hpp
+#define PublishedBloomFilter_hpp
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "OrdinaryBloomFilter.hpp"
+
+namespace bloom {
+
+/** Small process-wide integers identifying threads, handed out on a thread's
+ *  first call and recycled when it exits.
+ */
+class ThreadIndex {
+
+public:
+
+    static size_t Get() {
+        thread_local Holder holder;
+        return holder.id;
+    }
+
+private:
+
+    struct Registry {
+        std::mutex lock;
+        std::vector<size_t> free;
+        size_t next = 0;
+    };
+
+    /** Never destroyed, so it outlives the thread_local holders of threads
+     *  exiting during static destruction.
+     */
+    static Registry& GetRegistry() {
+        static Registry *registry = new Registry();
+        return *registry;
+    }
+
+    struct Holder {
+        size_t id;
+
+        Holder() {
+            Registry &r = GetRegistry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            if(r.free.empty()){
+                id = r.next++;
+            } else {
+                id = r.free.back();
+                r.free.pop_back();
+            }
+        }
+
+        ~Holder() {
+            Registry &r = GetRegistry();
+            std::lock_guard<std::mutex> guard(r.lock);
+            r.free.push_back(id);
+        }
+    };
+
+}; // class ThreadIndex
+
+/** An ordinary Bloom filter that one writer rebuilds while any number of
+ *  threads keep querying it, RCU style.
+ *
+ *  Two buffers are kept. Readers use the published one and never block: a
+ *  query announces the current epoch in the calling thread's slot, reads the
+ *  published pointer, and clears the slot when done. The writer fills the
+ *  other buffer and publishes it with a single atomic swap; the buffer it
+ *  replaces is handed back by the next BeginUpdate once every reader that
+ *  may still see it has left.
+ *
+ *  Threads beyond MaxReaderThreads share one counter instead of a slot;
+ *  their queries are still wait-free, but a steady stream of them can delay
+ *  BeginUpdate.
+ *
+ *  @param T     Contained type being indexed
+ *  @param Alloc Allocator for the bit arrays
+ */
+template <typename T, typename Alloc = std::allocator<unsigned char>>
+class PublishedBloomFilter {
+
+public:
+
+    typedef OrdinaryBloomFilter<T, Alloc> Filter;
+
+    /** Constructor. Both buffers start empty.
+     *  @see AbstractBloomFilter::AbstractBloomFilter
+     */
+    explicit
+    PublishedBloomFilter(uint8_t numHashes, size_t numBytes, Alloc const& alloc = Alloc())
+    : m_first(numHashes, numBytes, alloc), m_second(numHashes, numBytes, alloc),
+      m_current(&m_first), m_back(&m_second), m_epoch(1), m_retireEpoch(0),
+      m_slots(new Slot[MaxReaderThreads])
+    {}
+
+    PublishedBloomFilter(PublishedBloomFilter const&) = delete;
+    PublishedBloomFilter& operator=(PublishedBloomFilter const&) = delete;
+
+    /** Queries the published filter. Wait-free.
+     *
+     *  @param  o Object to query
+     *  @return true if object is indexed, false if the object is not indexed.
+     */
+    bool Query(T const& o) const {
+        return Read([&](Filter const& bf){ return bf.Query(o); });
+    }
+
+    /** Runs a read-only function on the published filter, e.g. a batched
+     *  query, and returns its result. The filter must not be used after the
+     *  function returns. Reads may nest; the outer filter stays protected
+     *  until the outer function returns.
+     *
+     *  @param f Function taking Filter const&
+     */
+    template <typename F>
+    auto Read(F f) const -> decltype(f(std::declval<Filter const&>())) {
+        size_t id = ThreadIndex::Get();
+        if(id < MaxReaderThreads){
+            SlotGuard guard(m_slots[id].value, m_epoch.load(std::memory_order_acquire));
+            return f(*m_current.load(std::memory_order_seq_cst));
+        }
+        CountGuard guard(m_overflow.value);
+        return f(*m_current.load(std::memory_order_seq_cst));
+    }
+
+    /** Serializes the published filter.
+     *  @see OrdinaryBloomFilter::Serialize
+     */
+    void Serialize(std::ostream &os) const {
+        Read([&](Filter const& bf){ bf.Serialize(os); return 0; });
+    }
+
+    /** Returns the buffer for the next version, once no reader can still be
+     *  using it. Its contents are those of the version published before the
+     *  current one: call Clear() to rebuild from scratch, or Union() with
+     *  Published() to apply incremental inserts. Writer only.
+     *
+     *  @return The back buffer, exclusive to the writer until Publish
+     */
+    Filter& BeginUpdate() {
+        WaitForReaders(m_retireEpoch);
+        return *m_back;
+    }
+
+    /** Atomically makes the back buffer the published filter. Queries that
+     *  start afterwards see it; the previous filter becomes the back buffer.
+     *  Does not wait for readers. Writer only.
+     */
+    void Publish() {
+        Filter *old = m_current.exchange(m_back, std::memory_order_seq_cst);
+        // Readers announcing this epoch or later loaded the new pointer.
+        m_retireEpoch = m_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+        m_back = old;
+    }
+
+    /** Returns the published filter. Only the writer may use it directly,
+     *  since it stays valid only until the next BeginUpdate.
+     */
+    Filter const& Published() const {
+        return *m_current.load(std::memory_order_acquire);
+    }
+
+    /** Number of threads given a private reader slot.
+     */
+    static const size_t MaxReaderThreads = 128;
+
+private:
+
+    /** Per-thread announced epoch, 0 when not reading, on its own cache line.
+     */
+    struct Slot {
+        std::atomic<uint64_t> value;
+        char pad[64 - sizeof(std::atomic<uint64_t>)];
+
+        Slot() : value(0) {}
+    };
+
+    /** Announces an epoch in the calling thread's slot. A Read nested in
+     *  another on the same thread finds the slot already set and leaves it
+     *  alone: the outer epoch is older, so it also protects every buffer the
+     *  inner Read can see, and only the outermost guard clears it.
+     */
+    struct SlotGuard {
+        std::atomic<uint64_t> &slot;
+        bool outermost;
+
+        SlotGuard(std::atomic<uint64_t> &s, uint64_t epoch)
+        : slot(s), outermost(s.load(std::memory_order_relaxed) == 0) {
+            if(outermost){
+                slot.store(epoch, std::memory_order_seq_cst);
+            }
+        }
+
+        ~SlotGuard() {
+            if(outermost){
+                slot.store(0, std::memory_order_release);
+            }
+        }
+    };
+
+    struct CountGuard {
+        std::atomic<uint64_t> &count;
+
+        explicit CountGuard(std::atomic<uint64_t> &c) : count(c) {
+            count.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        ~CountGuard() {
+            count.fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    /** Waits until no reader announced an epoch before the given one.
+     */
+    void WaitForReaders(uint64_t epoch) const {
+        for(size_t i = 0; i < MaxReaderThreads; i++){
+            for(;;){
+                uint64_t e = m_slots[i].value.load(std::memory_order_seq_cst);
+                if(e == 0 || e >= epoch){
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+        if(epoch != 0){
+            while(m_overflow.value.load(std::memory_order_seq_cst) != 0){
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    Filter m_first;
+    Filter m_second;
+
+    std::atomic<Filter*> m_current;
+    Filter *m_back;
+
+    std::atomic<uint64_t> m_epoch;
+
+    /** First epoch in which the back buffer was no longer published.
+     */
+    uint64_t m_retireEpoch;
+
+    std::unique_ptr<Slot[]> m_slots;
+    mutable Slot m_overflow;
+
+}; // class PublishedBloomFilter
+
+template <typename T, typename Alloc>
+const size_t PublishedBloomFilter<T, Alloc>::MaxReaderThreads;
+
+} // namespace bloom
+
+#endif
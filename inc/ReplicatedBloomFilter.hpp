@@ -0,0 +1,115 @@
+#ifndef ReplicatedBloomFilter_hpp
+#define ReplicatedBloomFilter_hpp
+
+#include <vector>
+#include "LargePageAllocator.hpp"
+#include "OrdinaryBloomFilter.hpp"
+
+namespace bloom {
+
+/** A read-mostly ordinary Bloom filter keeping one replica of its bit array
+ *  on every NUMA node. Queries read the replica local to the calling thread,
+ *  so no lookup crosses the socket interconnect; inserts and unions are
+ *  applied to every replica and are correspondingly more expensive.
+ *
+ *  @param T Contained type being indexed
+ */
+template <typename T>
+class ReplicatedBloomFilter : public AbstractBloomFilter<T> {
+
+public:
+
+    typedef OrdinaryBloomFilter<T, LargePageAllocator<unsigned char>> Replica;
+
+    /** Creates an empty filter with a replica on each node.
+     *  @see AbstractBloomFilter::AbstractBloomFilter
+     *
+     *  @param pages Page size policy for the replicas
+     */
+    explicit
+    ReplicatedBloomFilter(uint8_t numHashes, size_t numBytes,
+                          PagePolicy pages = PagePolicy::TransparentHuge)
+    : AbstractBloomFilter<T>(numHashes, numBytes)
+    {
+        int nodes = NumaNodeCount();
+        m_replicas.reserve(nodes);
+        for(int node = 0; node < nodes; node++){
+            m_replicas.emplace_back(numHashes, numBytes,
+                LargePageAllocator<unsigned char>(pages, NumaPolicy::Bind, node));
+        }
+    }
+
+    /** Creates replicas of an existing ordinary filter on each node, with
+     *  the same layout.
+     *
+     *  @param src   Filter to replicate
+     *  @param pages Page size policy for the replicas
+     */
+    template <typename A>
+    explicit
+    ReplicatedBloomFilter(OrdinaryBloomFilter<T, A> const& src,
+                          PagePolicy pages = PagePolicy::TransparentHuge)
+    : AbstractBloomFilter<T>(src.GetNumHashes(), src.GetnumBytes())
+    {
+        int nodes = NumaNodeCount();
+        m_replicas.reserve(nodes);
+        for(int node = 0; node < nodes; node++){
+            m_replicas.emplace_back(src.GetNumHashes(), src.GetnumBytes(), src.GetLayout(),
+                LargePageAllocator<unsigned char>(pages, NumaPolicy::Bind, node));
+            m_replicas.back().Union(src);
+        }
+    }
+
+    virtual void Insert(T const& o) {
+        for(size_t i = 0; i < m_replicas.size(); i++){
+            m_replicas[i].Insert(o);
+        }
+    }
+
+    /** Queries the replica on the calling thread's node. The node is looked
+     *  up once per thread, so threads are expected to stay pinned to a node.
+     */
+    virtual bool Query(T const& o) const {
+        return LocalReplica().Query(o);
+    }
+
+    virtual void Serialize(std::ostream &os) const {
+        m_replicas[0].Serialize(os);
+    }
+
+    /** Update every replica by adding the contents of an ordinary BF.
+     *  @see OrdinaryBloomFilter::Union
+     */
+    template <typename A>
+    void Union(OrdinaryBloomFilter<T, A> const& other){
+        for(size_t i = 0; i < m_replicas.size(); i++){
+            m_replicas[i].Union(other);
+        }
+    }
+
+    size_t GetNumReplicas() const {
+        return m_replicas.size();
+    }
+
+    /** Returns the replica placed on the given node.
+     */
+    Replica const& GetReplica(int node) const {
+        return m_replicas[node];
+    }
+
+    /** Returns the replica placed on the calling thread's node.
+     */
+    Replica const& LocalReplica() const {
+        static thread_local int node = CurrentNumaNode();
+        return m_replicas[(size_t) node < m_replicas.size() ? node : 0];
+    }
+
+private:
+
+    std::vector<Replica> m_replicas;
+
+}; // class ReplicatedBloomFilter
+
+} // namespace bloom
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef ShardedBloomFilter_hpp
+#define ShardedBloomFilter_hpp
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "OrdinaryBloomFilter.hpp"
+
+namespace bloom {
+
+/** A Bloom filter partitioned into independent ordinary BFs. Each object is
+ *  routed by a dedicated hash to exactly one shard, and each shard has its own
+ *  spinlock, so threads inserting into different shards never contend and no
+ *  atomic operations are needed on the bit arrays themselves.
+ *
+ *  @param T Contained type being indexed
+ */
+template <typename T>
+class ShardedBloomFilter : public AbstractBloomFilter<T> {
+
+public:
+
+    /** Constructor
+     *
+     *  @param numHashes Number of hashes per object
+     *  @param numBytes  Total size of the bit arrays, rounded up to a multiple
+     *                   of numShards
+     *  @param numShards Number of independent partitions, at least 1
+     *  @throws std::invalid_argument if numShards is 0
+     */
+    explicit
+    ShardedBloomFilter(uint8_t numHashes, size_t numBytes, size_t numShards)
+    : AbstractBloomFilter<T>(numHashes, ShardBytes(numBytes, numShards) * numShards),
+      m_locks(new SpinLock[numShards])
+    {
+        m_shards.reserve(numShards);
+        for(size_t i = 0; i < numShards; i++){
+            m_shards.emplace_back(numHashes, ShardBytes(numBytes, numShards));
+        }
+    }
+
+    virtual void Insert(T const& o) {
+        size_t s = GetShardIndex(o);
+        m_locks[s].Lock();
+        m_shards[s].Insert(o);
+        m_locks[s].Unlock();
+    }
+
+    /** Inserts an array of objects. Objects are first grouped by shard, then
+     *  each shard's lock is taken once for its whole group.
+     *
+     *  @param keys Objects to insert
+     *  @param n    Number of objects
+     */
+    void InsertBatch(T const* keys, size_t n) {
+        size_t numShards = m_shards.size();
+        std::vector<size_t> route(n);
+        std::vector<size_t> start(numShards + 1, 0);
+        for(size_t i = 0; i < n; i++){
+            route[i] = GetShardIndex(keys[i]);
+            start[route[i] + 1]++;
+        }
+        for(size_t s = 0; s < numShards; s++){
+            start[s + 1] += start[s];
+        }
+
+        std::vector<size_t> order(n);
+        std::vector<size_t> fill(start.begin(), start.end() - 1);
+        for(size_t i = 0; i < n; i++){
+            order[fill[route[i]]++] = i;
+        }
+
+        for(size_t s = 0; s < numShards; s++){
+            if(start[s] == start[s + 1]){
+                continue;
+            }
+            m_locks[s].Lock();
+            for(size_t j = start[s]; j < start[s + 1]; j++){
+                m_shards[s].Insert(keys[order[j]]);
+            }
+            m_locks[s].Unlock();
+        }
+    }
+
+    virtual bool Query(T const& o) const {
+        size_t s = GetShardIndex(o);
+        m_locks[s].Lock();
+        bool present = m_shards[s].Query(o);
+        m_locks[s].Unlock();
+        return present;
+    }
+
+    /** Update this Bloom filter by adding the contents of a second one with
+     *  the same shape, shard by shard. The other filter must not be modified
+     *  concurrently.
+     *  @see OrdinaryBloomFilter::Union
+     *
+     *  @param other BF to combine into this one
+     *  @throws std::invalid_argument if other differs in number of shards
+     *          or their shape
+     */
+    void Union(ShardedBloomFilter<T> const& other){
+        if(other.m_shards.size() != m_shards.size() || other.GetnumBytes() != super::GetnumBytes()
+           || other.GetNumHashes() != super::GetNumHashes()){
+            throw std::invalid_argument("ShardedBloomFilter::Union: BFs differ in shards or shape");
+        }
+        for(size_t s = 0; s < m_shards.size(); s++){
+            m_locks[s].Lock();
+            m_shards[s].Union(other.m_shards[s]);
+            m_locks[s].Unlock();
+        }
+    }
+
+    /** Serializes the whole filter as a single object: the number of hashes
+     *  and shards, followed by each shard in OrdinaryBloomFilter format.
+     */
+    virtual void Serialize(std::ostream &os) const {
+        uint8_t numHashes = super::GetNumHashes();
+        size_t numShards = m_shards.size();
+
+        os.write((const char *) &numHashes, sizeof(uint8_t));
+        os.write((const char *) &numShards, sizeof(size_t));
+
+        for(size_t s = 0; s < numShards; s++){
+            m_locks[s].Lock();
+            m_shards[s].Serialize(os);
+            m_locks[s].Unlock();
+        }
+    }
+
+    /** Create a ShardedBloomFilter from the content of a binary input
+     *  stream. Only the number of shards and their shapes are validated.
+     *
+     *  @param  is Input stream to read from
+     *  @return Deserialized ShardedBloomFilter
+     *  @throws std::invalid_argument if there are no shards, or they differ
+     *          in shape from each other or from the header
+     */
+    static ShardedBloomFilter<T> Deserialize(std::istream &is){
+        uint8_t numHashes = 0;
+        size_t numShards = 0;
+
+        is.read((char *) &numHashes, sizeof(uint8_t));
+        is.read((char *) &numShards, sizeof(size_t));
+        if(!is || numShards == 0){
+            throw std::invalid_argument("ShardedBloomFilter::Deserialize: no shards");
+        }
+
+        std::vector<OrdinaryBloomFilter<T>> shards;
+        shards.reserve(numShards);
+        for(size_t s = 0; s < numShards; s++){
+            shards.push_back(OrdinaryBloomFilter<T>::Deserialize(is));
+            if(shards[s].GetNumHashes() != numHashes || shards[s].GetnumBytes() != shards[0].GetnumBytes()){
+                throw std::invalid_argument("ShardedBloomFilter::Deserialize: shards differ in shape");
+            }
+        }
+
+        return ShardedBloomFilter<T>(numHashes, std::move(shards));
+    }
+
+    /** Returns the shard an object is routed to.
+     */
+    size_t GetShardIndex(T const& o) const {
+        // Salt numHashes is never used for probing, so routing is independent
+        // of the bit positions inside a shard.
+        return super::ComputeHash(o, super::GetNumHashes()) % m_shards.size();
+    }
+
+    size_t GetNumShards() const {
+        return m_shards.size();
+    }
+
+    /** Returns a shard. Not synchronized with concurrent inserts.
+     */
+    OrdinaryBloomFilter<T> const& GetShard(size_t s) const {
+        return m_shards[s];
+    }
+
+private:
+
+    typedef AbstractBloomFilter<T> super;
+
+    /** Test-and-test-and-set lock, padded to its own cache line.
+     */
+    struct SpinLock {
+        std::atomic<bool> locked;
+        char pad[64 - sizeof(std::atomic<bool>)];
+
+        SpinLock() : locked(false) {}
+
+        void Lock() {
+            while(locked.exchange(true, std::memory_order_acquire)){
+                while(locked.load(std::memory_order_relaxed)){
+                }
+            }
+        }
+
+        void Unlock() {
+            locked.store(false, std::memory_order_release);
+        }
+    };
+
+    ShardedBloomFilter(uint8_t numHashes, std::vector<OrdinaryBloomFilter<T>>&& shards)
+    : AbstractBloomFilter<T>(numHashes, shards.empty() ? 0 : shards[0].GetnumBytes() * shards.size()),
+      m_shards(std::move(shards)), m_locks(new SpinLock[m_shards.size()])
+    {}
+
+    static size_t ShardBytes(size_t numBytes, size_t numShards) {
+        if(numShards == 0){
+            throw std::invalid_argument("ShardedBloomFilter: numShards must be at least 1");
+        }
+        return (numBytes + numShards - 1) / numShards;
+    }
+
+    std::vector<OrdinaryBloomFilter<T>> m_shards;
+    std::unique_ptr<SpinLock[]> m_locks;
+
+}; // class ShardedBloomFilter
+
+} // namespace bloom
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef SlidingWindowBloomFilter_hpp
+#define SlidingWindowBloomFilter_hpp
+
+#include <stdexcept>
+#include <vector>
+#include "OrdinaryBloomFilter.hpp"
+
+namespace bloom {
+
+/** A Bloom filter over a sliding window of recent insertions. Maintains a
+ *  ring of ordinary BFs ("generations"); inserts go to the newest generation
+ *  and a query is positive if any generation contains the object. Rotating
+ *  discards the oldest generation wholesale by clearing its bit array, so
+ *  items expire without being tracked or deleted individually.
+ *
+ *  With G generations of N inserts each, an object is guaranteed to be found
+ *  for at least (G - 1) * N inserts after its own, and forgotten after at
+ *  most G * N. For time-based windows, disable automatic rotation and call
+ *  Rotate() once per period (e.g. per training step).
+ *
+ *  @param T Contained type being indexed
+ */
+template <typename T>
+class SlidingWindowBloomFilter : public AbstractBloomFilter<T> {
+
+public:
+
+    /** Constructor
+     *
+     *  @param numHashes            Number of hashes per object
+     *  @param numBytes             Size of each generation's bit array
+     *  @param numGenerations       Number of generations in the ring, at
+     *                              least 1
+     *  @param insertsPerGeneration Inserts after which the filter rotates
+     *                              automatically; 0 to rotate only on demand
+     *  @throws std::invalid_argument if numGenerations is 0
+     */
+    explicit
+    SlidingWindowBloomFilter(uint8_t numHashes, size_t numBytes,
+                             size_t numGenerations, size_t insertsPerGeneration = 0)
+    : AbstractBloomFilter<T>(numHashes, numBytes),
+      m_current(0), m_inserts(0), m_insertsPerGeneration(insertsPerGeneration)
+    {
+        if(numGenerations == 0){
+            throw std::invalid_argument("SlidingWindowBloomFilter: numGenerations must be at least 1");
+        }
+        m_generations.assign(numGenerations, OrdinaryBloomFilter<T>(numHashes, numBytes));
+    }
+
+    virtual void Insert(T const& o) {
+        if(m_insertsPerGeneration != 0 && m_inserts == m_insertsPerGeneration){
+            Rotate();
+        }
+        m_generations[m_current].Insert(o);
+        m_inserts++;
+    }
+
+    /** Queries whether an object was inserted within the window. The probe
+     *  positions are computed once and checked against every generation.
+     */
+    virtual bool Query(T const& o) const {
+        const uint8_t numHashes = super::GetNumHashes();
+        size_t pos[256];
+        for(uint8_t i = 0; i < numHashes; i++){
+            pos[i] = m_generations[0].GetBitIndex(o, i);
+        }
+
+        for(size_t g = 0; g < m_generations.size(); g++){
+            if(bits::TestBits(m_generations[g].Data(), super::GetnumBytes(), pos, numHashes)){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Expires the oldest generation and makes it the (empty) newest one.
+     *  This clears that generation's bit array, so it takes O(numBytes)
+     *  time, not constant time; it does not depend on how many objects the
+     *  generation held. With automatic rotation the cost falls on the
+     *  insert that triggers it.
+     */
+    void Rotate() {
+        m_current = (m_current + 1) % m_generations.size();
+        m_generations[m_current].Clear();
+        m_inserts = 0;
+    }
+
+    size_t GetNumGenerations() const {
+        return m_generations.size();
+    }
+
+    /** Serializes the window: the number of hashes, generations, the ring
+     *  cursor and rotation state, then each generation in ring order in
+     *  OrdinaryBloomFilter format.
+     */
+    virtual void Serialize(std::ostream &os) const {
+        uint8_t numHashes = super::GetNumHashes();
+        size_t numGenerations = m_generations.size();
+
+        os.write((const char *) &numHashes, sizeof(uint8_t));
+        os.write((const char *) &numGenerations, sizeof(size_t));
+        os.write((const char *) &m_current, sizeof(size_t));
+        os.write((const char *) &m_inserts, sizeof(size_t));
+        os.write((const char *) &m_insertsPerGeneration, sizeof(size_t));
+
+        for(size_t g = 0; g < numGenerations; g++){
+            m_generations[g].Serialize(os);
+        }
+    }
+
+    /** Create a SlidingWindowBloomFilter from the content of a binary input
+     *  stream. Only the ring and the shapes of its generations are
+     *  validated.
+     *
+     *  @param  is Input stream to read from
+     *  @return Deserialized SlidingWindowBloomFilter
+     *  @throws std::invalid_argument if there are no generations, the ring
+     *          cursor is out of range, or the generations differ in shape
+     *          from each other or from the header
+     */
+    static SlidingWindowBloomFilter<T> Deserialize(std::istream &is){
+        uint8_t numHashes;
+        size_t numGenerations, current, inserts, insertsPerGeneration;
+
+        is.read((char *) &numHashes, sizeof(uint8_t));
+        is.read((char *) &numGenerations, sizeof(size_t));
+        is.read((char *) &current, sizeof(size_t));
+        is.read((char *) &inserts, sizeof(size_t));
+        is.read((char *) &insertsPerGeneration, sizeof(size_t));
+
+        if(!is || numGenerations == 0 || current >= numGenerations){
+            throw std::invalid_argument("SlidingWindowBloomFilter::Deserialize: invalid ring of generations");
+        }
+
+        std::vector<OrdinaryBloomFilter<T>> generations;
+        generations.reserve(numGenerations);
+        for(size_t g = 0; g < numGenerations; g++){
+            generations.push_back(OrdinaryBloomFilter<T>::Deserialize(is));
+            if(generations[g].GetNumHashes() != numHashes
+               || generations[g].GetnumBytes() != generations[0].GetnumBytes()){
+                throw std::invalid_argument("SlidingWindowBloomFilter::Deserialize: generations differ in shape");
+            }
+        }
+
+        return SlidingWindowBloomFilter<T>(numHashes, std::move(generations), current, inserts, insertsPerGeneration);
+    }
+
+private:
+
+    typedef AbstractBloomFilter<T> super;
+
+    SlidingWindowBloomFilter(uint8_t numHashes, std::vector<OrdinaryBloomFilter<T>>&& generations,
+                             size_t current, size_t inserts, size_t insertsPerGeneration)
+    : AbstractBloomFilter<T>(numHashes, generations[0].GetnumBytes()),
+      m_generations(std::move(generations)),
+      m_current(current), m_inserts(inserts), m_insertsPerGeneration(insertsPerGeneration)
+    {}
+
+    std::vector<OrdinaryBloomFilter<T>> m_generations;
+    size_t m_current;
+    size_t m_inserts;
+    size_t m_insertsPerGeneration;
+
+}; // class SlidingWindowBloomFilter
+
+} // namespace bloom
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef StaticFilter_hpp
+#define StaticFilter_hpp
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "OrdinaryBloomFilter.hpp"
+
+namespace bloom {
+
+/** An immutable xor filter (Graf & Lemire, "Xor Filters: Faster and Smaller
+ *  Than Bloom and Cuckoo Filters"). Built once from a known set of objects,
+ *  it uses about 1.23 * 8 * sizeof(Fingerprint) bits per object for a false
+ *  positive ratio of 2^-(8 * sizeof(Fingerprint)), and answers every query
+ *  with exactly three memory accesses.
+ *
+ *  There is no Insert: the filter offers the Query/Serialize surface of
+ *  AbstractBloomFilter for read-only paths only.
+ *
+ *  @param T           Contained type being indexed
+ *  @param Fingerprint uint8_t (~0.4% false positives) or uint16_t (~0.0015%)
+ */
+template <typename T, typename Fingerprint = uint8_t>
+class StaticFilter {
+
+public:
+
+    /** Builds a filter containing the given objects. Duplicates are allowed.
+     *  Hashing is spread over numThreads threads; the peeling phase that
+     *  follows is sequential and linear in the number of objects.
+     *
+     *  @param  keys       Objects to index
+     *  @param  n          Number of objects
+     *  @param  numThreads Number of threads hashing the objects
+     *  @return The new StaticFilter
+     */
+    static StaticFilter Build(T const* keys, size_t n, unsigned numThreads = 1) {
+        std::vector<uint64_t> hashes(n);
+        numThreads = std::max(1u, numThreads);
+        if(numThreads == 1 || n < 4096){
+            HashRange(keys, 0, n, hashes.data());
+        } else {
+            std::vector<std::thread> workers;
+            size_t chunk = (n + numThreads - 1) / numThreads;
+            for(unsigned t = 0; t < numThreads; t++){
+                size_t begin = std::min(n, t * chunk), end = std::min(n, begin + chunk);
+                workers.emplace_back(HashRange, keys, begin, end, hashes.data());
+            }
+            for(size_t t = 0; t < workers.size(); t++){
+                workers[t].join();
+            }
+        }
+
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+        size_t blockLength = (32 + 123 * hashes.size() / 100) / 3 + 1;
+        StaticFilter r(blockLength);
+        for(uint64_t seed = 0x9e3779b97f4a7c15ULL; !r.Peel(hashes, seed); seed = MurmurHash3::fmix64(seed)){
+        }
+        return r;
+    }
+
+    /** Queries whether an object is indexed by this filter. False positives
+     *  are possible, false negatives are not.
+     *
+     *  @param  o Object to query
+     *  @return true if object is indexed, false if the object is not indexed.
+     */
+    bool Query(T const& o) const {
+        uint64_t h = MurmurHash3::fmix64(KeyHash(o) + m_seed);
+        Fingerprint f = FingerprintOf(h);
+        return f == (m_fingerprints[Slot(h, 0)] ^ m_fingerprints[Slot(h, 1)] ^ m_fingerprints[Slot(h, 2)]);
+    }
+
+    /** Serializes this filter into the given output stream. Output will
+     *  be in a raw binary format.
+     *
+     *  @param os output stream to serialize the filter into
+     */
+    void Serialize(std::ostream &os) const {
+        uint8_t width = sizeof(Fingerprint);
+        uint64_t blockLength = m_blockLength;
+
+        os.write((const char *) &width, sizeof(uint8_t));
+        os.write((const char *) &m_seed, sizeof(uint64_t));
+        os.write((const char *) &blockLength, sizeof(uint64_t));
+        os.write((const char *) m_fingerprints.data(), m_fingerprints.size() * sizeof(Fingerprint));
+    }
+
+    /** Create a StaticFilter from the content of a binary input stream.
+     *  Only the fingerprint width and the length of the stream are
+     *  validated.
+     *
+     *  @param  is Input stream to read from
+     *  @return Deserialized StaticFilter
+     *  @throws std::invalid_argument if the filter was written with another
+     *          Fingerprint type or the stream is cut short
+     */
+    static StaticFilter Deserialize(std::istream &is) {
+        uint8_t width = 0;
+        uint64_t seed = 0, blockLength = 0;
+
+        is.read((char *) &width, sizeof(uint8_t));
+        is.read((char *) &seed, sizeof(uint64_t));
+        is.read((char *) &blockLength, sizeof(uint64_t));
+        if(!is){
+            throw std::invalid_argument("StaticFilter::Deserialize: header is cut short");
+        }
+        if(width != sizeof(Fingerprint)){
+            throw std::invalid_argument("StaticFilter::Deserialize: filter has another fingerprint width");
+        }
+
+        StaticFilter r(blockLength);
+        r.m_seed = seed;
+        is.read((char *) r.m_fingerprints.data(), r.m_fingerprints.size() * sizeof(Fingerprint));
+        if(!is){
+            throw std::invalid_argument("StaticFilter::Deserialize: fingerprints are cut short");
+        }
+        return r;
+    }
+
+    /** Returns the size of the fingerprint array in bytes.
+     */
+    size_t GetnumBytes() const {
+        return m_fingerprints.size() * sizeof(Fingerprint);
+    }
+
+private:
+
+    explicit
+    StaticFilter(size_t blockLength)
+    : m_seed(0), m_blockLength(blockLength), m_fingerprints(3 * blockLength, 0)
+    {}
+
+    static uint64_t KeyHash(T const& o) {
+        return AbstractBloomFilter<T>::ComputeHash(o, 0);
+    }
+
+    static void HashRange(T const* keys, size_t begin, size_t end, uint64_t *out) {
+        for(size_t i = begin; i < end; i++){
+            out[i] = KeyHash(keys[i]);
+        }
+    }
+
+    static Fingerprint FingerprintOf(uint64_t h) {
+        return (Fingerprint) (h ^ (h >> 32));
+    }
+
+    /** Position of the i-th probe of a mixed hash, in block i.
+     */
+    size_t Slot(uint64_t h, int i) const {
+        uint32_t r = (uint32_t) (i == 0 ? h : (h << (21 * i)) | (h >> (64 - 21 * i)));
+        return (size_t) (((uint64_t) r * m_blockLength) >> 32) + i * m_blockLength;
+    }
+
+    /** Tries to assign fingerprints with the given seed by peeling slots
+     *  that hold a single key.
+     *
+     *  @return false if the key hypergraph has a cycle for this seed
+     */
+    bool Peel(std::vector<uint64_t> const& keyHashes, uint64_t seed) {
+        size_t numSlots = m_fingerprints.size();
+        std::vector<uint32_t> count(numSlots, 0);
+        std::vector<uint64_t> mask(numSlots, 0);
+
+        m_seed = seed;
+        for(size_t k = 0; k < keyHashes.size(); k++){
+            uint64_t h = MurmurHash3::fmix64(keyHashes[k] + seed);
+            for(int i = 0; i < 3; i++){
+                size_t s = Slot(h, i);
+                count[s]++;
+                mask[s] ^= h;
+            }
+        }
+
+        std::vector<size_t> queue;
+        for(size_t s = 0; s < numSlots; s++){
+            if(count[s] == 1){
+                queue.push_back(s);
+            }
+        }
+
+        std::vector<std::pair<uint64_t, size_t>> stack;
+        stack.reserve(keyHashes.size());
+        while(!queue.empty()){
+            size_t s = queue.back();
+            queue.pop_back();
+            if(count[s] != 1){
+                continue;
+            }
+            uint64_t h = mask[s];
+            stack.push_back(std::make_pair(h, s));
+            for(int i = 0; i < 3; i++){
+                size_t t = Slot(h, i);
+                count[t]--;
+                mask[t] ^= h;
+                if(count[t] == 1){
+                    queue.push_back(t);
+                }
+            }
+        }
+
+        if(stack.size() != keyHashes.size()){
+            return false;
+        }
+
+        std::fill(m_fingerprints.begin(), m_fingerprints.end(), 0);
+        for(size_t j = stack.size(); j > 0; j--){
+            uint64_t h = stack[j - 1].first;
+            size_t s = stack[j - 1].second;
+            m_fingerprints[s] = 0;
+            m_fingerprints[s] = FingerprintOf(h) ^ m_fingerprints[Slot(h, 0)]
+                              ^ m_fingerprints[Slot(h, 1)] ^ m_fingerprints[Slot(h, 2)];
+        }
+        return true;
+    }
+
+    uint64_t m_seed;
+    size_t m_blockLength;
+    std::vector<Fingerprint> m_fingerprints;
+
+}; // class StaticFilter
+
+} // namespace bloom
+
+#endif
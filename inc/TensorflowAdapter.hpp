@@ -0,0 +1,43 @@
+#ifndef TensorflowAdapter_hpp
+#define TensorflowAdapter_hpp
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "OrdinaryBloomFilter.hpp"
+
+/** Helpers taking TensorFlow tensors. This is the only header of the library
+ *  that depends on TensorFlow; the filters themselves take plain arrays.
+ */
+namespace bloom {
+
+/** Dummy lookup of an index in a tensor of indices.
+ *
+ *  @param indices int32 tensor of indices
+ *  @param x       Index to look for
+ *  @return        1 if x is in indices, 0 otherwise
+ */
+inline int find(const tensorflow::Tensor& indices, int x) {
+    auto indices_flat = indices.flat<int>();
+    for (int i=0; i<indices_flat.size(); ++i) {
+        if (indices_flat(i) == x)
+            return 1;
+    }
+    return 0;
+}
+
+/** Counts the false positives of a filter over the universe [0, N).
+ *  @see OrdinaryBloomFilter::Compute_False_Positives
+ *
+ *  @param bf      Filter built from indices
+ *  @param N       Size of the universe
+ *  @param indices int32 tensor of the inserted indices
+ */
+template <typename T, typename Alloc>
+int Compute_False_Positives(OrdinaryBloomFilter<T, Alloc> const& bf, int N, const tensorflow::Tensor& indices) {
+    auto indices_flat = indices.flat<int>();
+    return bf.Compute_False_Positives(N, indices_flat.data(), indices_flat.size());
+}
+
+} // namespace bloom
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef TwoLevelBloomFilter_hpp
+#define TwoLevelBloomFilter_hpp
+
+#include "OrdinaryBloomFilter.hpp"
+
+namespace bloom {
+
+/** A large ordinary Bloom filter fronted by a small summary filter that fits
+ *  in cache. Every object is inserted into both; a query first checks the
+ *  summary and only touches the large array if the summary answers true, so
+ *  most negative lookups cost no DRAM access.
+ *
+ *  The summary probes with the first summaryHashes of the main filter's
+ *  hashes, reduced modulo its own size, so a query hashes each salt once
+ *  for both levels. With one summary hash and n objects in a summary of m
+ *  bits, a negative query reaches the main filter with probability about
+ *  1 - exp(-n / m).
+ *
+ *  @param T     Contained type being indexed
+ *  @param Alloc Allocator for the main bit array
+ */
+template <typename T, typename Alloc = std::allocator<unsigned char>>
+class TwoLevelBloomFilter : public AbstractBloomFilter<T> {
+
+public:
+
+    typedef OrdinaryBloomFilter<T, Alloc> Filter;
+    typedef OrdinaryBloomFilter<T> Summary;
+
+    /** Constructor
+     *  @see AbstractBloomFilter::AbstractBloomFilter
+     *
+     *  @param summaryBytes  Size of the summary bit array, e.g. the L1 or L2
+     *                       cache size
+     *  @param summaryHashes Number of hashes probed in the summary, at most
+     *                       numHashes
+     */
+    explicit
+    TwoLevelBloomFilter(uint8_t numHashes, size_t numBytes, size_t summaryBytes,
+                        uint8_t summaryHashes = 1, Alloc const& alloc = Alloc())
+    : AbstractBloomFilter<T>(numHashes, numBytes),
+      m_main(numHashes, numBytes, alloc),
+      m_summary(std::min(summaryHashes, numHashes), summaryBytes)
+    {}
+
+    virtual void Insert(T const& o) {
+        m_main.Insert(o);
+        m_summary.Insert(o);
+    }
+
+    virtual bool Query(T const& o) const {
+        const uint8_t numHashes = super::GetNumHashes();
+        const uint8_t summaryHashes = m_summary.GetNumHashes();
+        size_t hash[256], pos[256];
+        for(uint8_t i = 0; i < summaryHashes; i++){
+            hash[i] = super::ComputeHash(o, i);
+            pos[i] = m_summary.BitIndexFromHash(hash[i], i);
+        }
+        if(!bits::TestBits(m_summary.Data(), m_summary.GetnumBytes(), pos, summaryHashes)){
+            return false;
+        }
+        for(uint8_t i = 0; i < numHashes; i++){
+            pos[i] = m_main.BitIndexFromHash(i < summaryHashes ? hash[i] : super::ComputeHash(o, i), i);
+        }
+        return bits::TestBits(m_main.Data(), m_main.GetnumBytes(), pos, numHashes);
+    }
+
+    /** Update this Bloom filter by adding the contents of a second one of
+     *  the same shape. Both levels are combined by logical OR, so the
+     *  summary of the result is exactly the summary of the union.
+     *  @see OrdinaryBloomFilter::Union
+     *
+     *  @param other BF to combine into this one
+     */
+    template <typename A>
+    void Union(TwoLevelBloomFilter<T, A> const& other){
+        m_main.Union(other.GetMain());
+        m_summary.Union(other.GetSummary());
+    }
+
+    /** Removes all objects from both levels.
+     */
+    void Clear(){
+        m_main.Clear();
+        m_summary.Clear();
+    }
+
+    /** Serializes the main filter followed by the summary, each in
+     *  OrdinaryBloomFilter format.
+     */
+    virtual void Serialize(std::ostream &os) const {
+        m_main.Serialize(os);
+        m_summary.Serialize(os);
+    }
+
+    /** Create a TwoLevelBloomFilter from the content of a binary input
+     *  stream. No validation is performed.
+     *
+     *  @param  is    Input stream to read from
+     *  @param  alloc Allocator for the main bit array of the result
+     *  @return Deserialized TwoLevelBloomFilter
+     */
+    static TwoLevelBloomFilter Deserialize(std::istream &is, Alloc const& alloc = Alloc()){
+        Filter main = Filter::Deserialize(is, alloc);
+        Summary summary = Summary::Deserialize(is);
+        return TwoLevelBloomFilter(std::move(main), std::move(summary));
+    }
+
+    Filter const& GetMain() const {
+        return m_main;
+    }
+
+    Summary const& GetSummary() const {
+        return m_summary;
+    }
+
+private:
+
+    typedef AbstractBloomFilter<T> super;
+
+    TwoLevelBloomFilter(Filter&& main, Summary&& summary)
+    : AbstractBloomFilter<T>(main.GetNumHashes(), main.GetnumBytes()),
+      m_main(std::move(main)), m_summary(std::move(summary))
+    {}
+
+    Filter m_main;
+    Summary m_summary;
+
+}; // class TwoLevelBloomFilter
+
+} // namespace bloom
+
+#endif
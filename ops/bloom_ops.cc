@@ -0,0 +1,213 @@
+/** TensorFlow CPU kernels building, decoding and merging ordinary Bloom
+ *  filters stored as int8 tensors of num_bytes bytes, bit-compatible with
+ *  OrdinaryBloomFilter<uint32_t>:
+ *
+ *  - BloomEncode(indices)          -> bloom     inserts every index
+ *  - BloomDecode(bloom, universe)  -> indices   indices in [0, universe) that query true
+ *  - BloomUnion(blooms)            -> bloom     bitwise OR of N filters
+ *
+ *  All kernels split their work over the op's intra-op thread pool and write
+ *  directly into the output tensors. Build with `make tf_ops`.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+#include "OrdinaryBloomFilter.hpp"
+
+using namespace tensorflow;
+
+namespace {
+
+typedef bloom::OrdinaryBloomFilter<uint32_t> Filter;
+
+// Rough per-element costs (in cycles) for the work sharder.
+const int64_t kCostPerProbe = 40;
+const int64_t kCostPerByte = 2;
+
+void ParallelFor(OpKernelContext *ctx, int64_t total, int64_t cost,
+                 std::function<void(int64_t, int64_t)> work) {
+    auto *workers = ctx->device()->tensorflow_cpu_worker_threads()->workers;
+    Shard(workers->NumThreads(), workers, total, cost, work);
+}
+
+bool QueryBits(const unsigned char *bits, size_t numBytes, int numHashes, uint32_t key) {
+    bool present = true;
+    for (int h = 0; h < numHashes && present; h++) {
+        size_t pos = Filter::BitIndex(key, (uint8_t) h, numBytes);
+        present = (bits[pos / 8] >> (pos % 8)) & 1;
+    }
+    return present;
+}
+
+} // namespace
+
+REGISTER_OP("BloomEncode")
+    .Input("indices: int32")
+    .Attr("num_hashes: int >= 1")
+    .Attr("num_bytes: int >= 1")
+    .Output("bloom: int8")
+    .SetShapeFn([](shape_inference::InferenceContext *c) {
+        int64 numBytes;
+        TF_RETURN_IF_ERROR(c->GetAttr("num_bytes", &numBytes));
+        c->set_output(0, c->Vector(numBytes));
+        return Status();
+    });
+
+REGISTER_OP("BloomDecode")
+    .Input("bloom: int8")
+    .Input("universe_size: int32")
+    .Attr("num_hashes: int >= 1")
+    .Output("indices: int32")
+    .SetShapeFn([](shape_inference::InferenceContext *c) {
+        c->set_output(0, c->Vector(shape_inference::InferenceContext::kUnknownDim));
+        return Status();
+    });
+
+REGISTER_OP("BloomUnion")
+    .Input("blooms: N * int8")
+    .Attr("N: int >= 1")
+    .Output("bloom: int8")
+    .SetShapeFn([](shape_inference::InferenceContext *c) {
+        c->set_output(0, c->input(0));
+        return Status();
+    });
+
+class BloomEncodeOp : public OpKernel {
+
+public:
+
+    explicit BloomEncodeOp(OpKernelConstruction *ctx) : OpKernel(ctx) {
+        OP_REQUIRES_OK(ctx, ctx->GetAttr("num_hashes", &m_numHashes));
+        OP_REQUIRES_OK(ctx, ctx->GetAttr("num_bytes", &m_numBytes));
+        OP_REQUIRES(ctx, m_numHashes <= 255,
+                    errors::InvalidArgument("num_hashes must be at most 255"));
+    }
+
+    void Compute(OpKernelContext *ctx) override {
+        auto indices = ctx->input(0).flat<int32>();
+
+        Tensor *output = nullptr;
+        OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({m_numBytes}), &output));
+        unsigned char *bits = reinterpret_cast<unsigned char *>(output->flat<int8>().data());
+        std::fill(bits, bits + m_numBytes, 0);
+
+        const size_t numBytes = m_numBytes;
+        const int numHashes = m_numHashes;
+        ParallelFor(ctx, indices.size(), kCostPerProbe * numHashes,
+                    [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; i++) {
+                uint32_t key = (uint32_t) indices(i);
+                for (int h = 0; h < numHashes; h++) {
+                    size_t pos = Filter::BitIndex(key, (uint8_t) h, numBytes);
+                    // Shards may set bits in the same byte concurrently.
+                    __atomic_fetch_or(&bits[pos / 8], (unsigned char) (1u << (pos % 8)),
+                                      __ATOMIC_RELAXED);
+                }
+            }
+        });
+    }
+
+private:
+
+    int m_numHashes;
+    int64 m_numBytes;
+
+};
+
+class BloomDecodeOp : public OpKernel {
+
+public:
+
+    explicit BloomDecodeOp(OpKernelConstruction *ctx) : OpKernel(ctx) {
+        OP_REQUIRES_OK(ctx, ctx->GetAttr("num_hashes", &m_numHashes));
+        OP_REQUIRES(ctx, m_numHashes <= 255,
+                    errors::InvalidArgument("num_hashes must be at most 255"));
+    }
+
+    void Compute(OpKernelContext *ctx) override {
+        const Tensor &bloom = ctx->input(0);
+        const Tensor &universe = ctx->input(1);
+        OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(universe.shape()),
+                    errors::InvalidArgument("universe_size must be a scalar"));
+        OP_REQUIRES(ctx, bloom.NumElements() > 0,
+                    errors::InvalidArgument("bloom must not be empty"));
+
+        const unsigned char *bits = reinterpret_cast<const unsigned char *>(bloom.flat<int8>().data());
+        const size_t numBytes = bloom.NumElements();
+        const int numHashes = m_numHashes;
+        const int32 universeSize = std::max<int32>(universe.scalar<int32>()(), 0);
+
+        std::vector<unsigned char> hit(universeSize);
+        ParallelFor(ctx, universeSize, kCostPerProbe * numHashes,
+                    [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; i++) {
+                hit[i] = QueryBits(bits, numBytes, numHashes, (uint32_t) i);
+            }
+        });
+
+        int64_t count = std::count(hit.begin(), hit.end(), 1);
+        Tensor *output = nullptr;
+        OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({count}), &output));
+        auto indices = output->flat<int32>();
+        int64_t j = 0;
+        for (int32 i = 0; i < universeSize; i++) {
+            if (hit[i]) {
+                indices(j++) = i;
+            }
+        }
+    }
+
+private:
+
+    int m_numHashes;
+
+};
+
+class BloomUnionOp : public OpKernel {
+
+public:
+
+    explicit BloomUnionOp(OpKernelConstruction *ctx) : OpKernel(ctx) {}
+
+    void Compute(OpKernelContext *ctx) override {
+        OpInputList blooms;
+        OP_REQUIRES_OK(ctx, ctx->input_list("blooms", &blooms));
+        const TensorShape &shape = blooms[0].shape();
+        for (int n = 1; n < blooms.size(); n++) {
+            OP_REQUIRES(ctx, blooms[n].shape() == shape,
+                        errors::InvalidArgument("all blooms must have the same shape"));
+        }
+
+        Tensor *output = nullptr;
+        OP_REQUIRES_OK(ctx, ctx->allocate_output(0, shape, &output));
+        int8 *out = output->flat<int8>().data();
+
+        std::vector<const int8 *> in(blooms.size());
+        for (int n = 0; n < blooms.size(); n++) {
+            in[n] = blooms[n].flat<int8>().data();
+        }
+
+        ParallelFor(ctx, shape.num_elements(), kCostPerByte * blooms.size(),
+                    [&](int64_t begin, int64_t end) {
+            std::copy(in[0] + begin, in[0] + end, out + begin);
+            for (size_t n = 1; n < in.size(); n++) {
+                const int8 *src = in[n];
+                for (int64_t i = begin; i < end; i++) {
+                    out[i] |= src[i];
+                }
+            }
+        });
+    }
+
+};
+
+REGISTER_KERNEL_BUILDER(Name("BloomEncode").Device(DEVICE_CPU), BloomEncodeOp);
+REGISTER_KERNEL_BUILDER(Name("BloomDecode").Device(DEVICE_CPU), BloomDecodeOp);
+REGISTER_KERNEL_BUILDER(Name("BloomUnion").Device(DEVICE_CPU), BloomUnionOp);
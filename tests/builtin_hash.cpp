@@ -0,0 +1,118 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "OrdinaryBloomFilter.hpp"
+
+/** A key with a user specialization that counts how often it is copied.
+ */
+struct Counted {
+    Counted(uint64_t v) : value(v) {}
+    Counted(Counted const& other) : value(other.value) { copies++; }
+
+    uint64_t value;
+    static size_t copies;
+};
+
+size_t Counted::copies = 0;
+
+namespace std {
+    template<> struct hash<bloom::HashParams<Counted>> {
+        size_t operator()(bloom::HashParams<Counted> const& s) const {
+            return bloom::MurmurHash3::fmix64(s.a.value * 31 + s.b);
+        }
+    };
+}
+
+struct Point {
+    uint32_t x;
+    uint32_t y;
+};
+
+enum class Color : uint16_t { Red, Green, Blue };
+
+/** Inserts n keys made by make(i) and checks there are no false negatives
+ *  and few false positives among n more.
+ */
+template <typename T, typename Make>
+bool Check(const char *name, Make make) {
+    const size_t n = 5000;
+    bloom::OrdinaryBloomFilter<T> bf(7, 8 * 1024);
+    for(size_t i = 0; i < n; i++){
+        bf.Insert(make(i));
+    }
+    for(size_t i = 0; i < n; i++){
+        if(!bf.Query(make(i))){
+            std::cout << "Error: Query for inserted " << name << " was false." << std::endl;
+            return false;
+        }
+    }
+    size_t falsePositives = 0;
+    for(size_t i = n; i < 2 * n; i++){
+        falsePositives += bf.Query(make(i));
+    }
+    // About 0.8% expected at 13 bits per key.
+    if(falsePositives > n / 40){
+        std::cout << "Error: Too many false positives for " << name << ": " << falsePositives << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]){
+
+    if(!Check<uint64_t>("uint64_t", [](size_t i){ return (uint64_t) i << 20; })
+       || !Check<int>("int", [](size_t i){ return -(int) i; })
+       || !Check<uint8_t>("uint8_t", [](size_t i){ return (uint8_t) (i < 5000 ? i % 64 : 64 + i % 192); })
+       || !Check<std::string>("std::string", [](size_t i){ return "key-" + std::to_string(i); })
+       || !Check<Point>("Point", [](size_t i){ return Point{(uint32_t) i, (uint32_t) (i * 7)}; })){
+        return 1;
+    }
+
+    // Strings hash their bytes, so byte-oriented callers can match them.
+    std::string key = "a key longer than eight bytes";
+    for(uint8_t salt = 0; salt < 4; salt++){
+        if(bloom::AbstractBloomFilter<std::string>::ComputeHash(key, salt)
+           != bloom::HashBytes(key.data(), key.size(), salt)){
+            std::cout << "Error: String hash differs from HashBytes." << std::endl;
+            return 1;
+        }
+    }
+    if(bloom::HashBytes(key.data(), key.size(), 0) == bloom::HashBytes(key.data(), key.size(), 1)){
+        std::cout << "Error: Salts do not change the hash." << std::endl;
+        return 1;
+    }
+
+    bloom::OrdinaryBloomFilter<Color> colors(3, 64);
+    colors.Insert(Color::Green);
+    if(!colors.Query(Color::Green)){
+        std::cout << "Error: Query for inserted enum was false." << std::endl;
+        return 1;
+    }
+
+    // User specializations still apply, and keys are not copied to hash them.
+    bloom::OrdinaryBloomFilter<Counted> counted(5, 1024);
+    Counted c(42);
+    Counted::copies = 0;
+    counted.Insert(c);
+    if(!counted.Query(c) || Counted::copies != 0){
+        std::cout << "Error: Hashing copied the key " << Counted::copies << " times." << std::endl;
+        return 1;
+    }
+    if(bloom::AbstractBloomFilter<Counted>::ComputeHash(c, 3) != bloom::MurmurHash3::fmix64(42 * 31 + 3)){
+        std::cout << "Error: User specialization was not used." << std::endl;
+        return 1;
+    }
+
+    // uint32_t keeps its 32-bit MurmurHash3.
+    uint32_t k = 12345, expected;
+    bloom::MurmurHash3::murmur_hash3_x86_32(&k, sizeof(k), 2, &expected);
+    if(bloom::AbstractBloomFilter<uint32_t>::ComputeHash(k, 2) != expected){
+        std::cout << "Error: uint32_t hash changed." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Tests passed." << std::endl;
+
+    return 0;
+}
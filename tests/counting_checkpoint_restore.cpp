@@ -0,0 +1,89 @@
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "CountingBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    // 60000 counters: 15 pages, the last one partial.
+    bloom::CountingBloomFilter<uint32_t> bf(4, 60000);
+    for(uint32_t i = 0; i < 2000; i++){
+        bf.Insert(i);
+    }
+    
+    std::stringstream base, log;
+    bf.Serialize(base);
+    bf.TrackChanges(true);
+    
+    bf.Insert(5000);
+    bf.Insert(5001);
+    size_t pages = bf.SerializeChanges(log);
+    if(pages == 0 || pages > 8){
+        std::cout << "Error: Checkpoint wrote " << pages << " pages for two inserts." << std::endl;
+        return 1;
+    }
+    
+    bf.Delete(10);
+    bf.Insert(6000);
+    bf.SerializeChanges(log);
+    
+    if(bf.SerializeChanges(log) != 0){
+        std::cout << "Error: Modified pages were not reset by the checkpoint." << std::endl;
+        return 1;
+    }
+    
+    const std::string baseImage = base.str(), logData = log.str();
+    bloom::CountingBloomFilter<uint32_t> restored = bloom::CountingBloomFilter<uint32_t>::Restore(base, log);
+    
+    std::stringstream expected, actual;
+    bf.Serialize(expected);
+    restored.Serialize(actual);
+    if(expected.str() != actual.str()){
+        std::cout << "Error: Restored BF differs from the original." << std::endl;
+        return 1;
+    }
+    
+    if(restored.Query(10) || !restored.Query(5001) || !restored.Query(6000)){
+        std::cout << "Error: Restored BF has wrong membership." << std::endl;
+        return 1;
+    }
+    
+    // A record cut short by a crash while appending is dropped, and the
+    // records before it are replayed.
+    const size_t recordHeader = sizeof(uint8_t) + sizeof(size_t) + sizeof(uint64_t);
+    size_t firstRecord = recordHeader + pages * (sizeof(uint64_t) + 4096);
+    size_t secondRecordEnd = logData.size() - recordHeader;
+    for(size_t cut = firstRecord + 1; cut < secondRecordEnd; cut += 1001){
+        std::stringstream image(baseImage), torn(logData.substr(0, cut));
+        bloom::CountingBloomFilter<uint32_t> partial = bloom::CountingBloomFilter<uint32_t>::Deserialize(image);
+        if(partial.ApplyChanges(torn) != 1 || !partial.Query(5001) || partial.Query(6000)){
+            std::cout << "Error: Truncated log was not replayed up to its last full record." << std::endl;
+            return 1;
+        }
+    }
+
+    // Logs of another filter or naming pages past the end are rejected.
+    std::string outOfRange = logData.substr(0, firstRecord);
+    uint64_t badPage = 15;
+    outOfRange.replace(recordHeader, sizeof(uint64_t), (const char *) &badPage, sizeof(uint64_t));
+    bloom::CountingBloomFilter<uint32_t> other(4, 60001);
+    other.TrackChanges(true);
+    other.Insert(1);
+    std::stringstream otherLog;
+    other.SerializeChanges(otherLog);
+    const std::string corrupt[] = { outOfRange, otherLog.str() };
+    for(int i = 0; i < 2; i++){
+        std::stringstream is(corrupt[i]);
+        try {
+            restored.ApplyChanges(is);
+            std::cout << "Error: Corrupt log " << i << " was applied." << std::endl;
+            return 1;
+        } catch(std::invalid_argument const&) {
+        }
+    }
+    
+    std::cout << "Tests passed." << std::endl;
+    
+    return 0;
+}
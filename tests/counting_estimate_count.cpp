@@ -0,0 +1,75 @@
+#include <iostream>
+#include <vector>
+#include "CountingBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    bloom::CountingBloomFilter<uint32_t> bf(4, 8192);
+    bloom::CountingBloomFilter<uint32_t> cu(4, 8192);
+
+    // Key i is inserted i % 20 times.
+    for(uint32_t i = 0; i < 400; i++){
+        for(uint32_t c = 0; c < i % 20; c++){
+            bf.Insert(i);
+            cu.InsertConservative(i);
+        }
+    }
+
+    size_t overBf = 0, overCu = 0;
+    for(uint32_t i = 0; i < 400; i++){
+        uint8_t a = bf.EstimateCount(i), b = cu.EstimateCount(i);
+        if(a < i % 20 || b < i % 20){
+            std::cout << "Error: Estimated count is below the true count." << std::endl;
+            return 1;
+        }
+        overBf += a - i % 20;
+        overCu += b - i % 20;
+    }
+    if(overCu > overBf){
+        std::cout << "Error: Conservative update overestimates more than plain insert." << std::endl;
+        return 1;
+    }
+
+    std::vector<uint32_t> keys;
+    for(uint32_t i = 0; i < 1003; i++){
+        keys.push_back(i);
+    }
+    std::vector<uint8_t> counts(keys.size());
+    bf.EstimateCountBatch(keys.data(), keys.size(), counts.data());
+    for(size_t j = 0; j < keys.size(); j++){
+        if(counts[j] != bf.EstimateCount(keys[j])){
+            std::cout << "Error: Batched estimate disagrees with EstimateCount." << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::pair<uint32_t, uint8_t>> top = cu.TopK(keys.data(), keys.size(), 20);
+    if(top.size() != 20){
+        std::cout << "Error: TopK returned the wrong number of candidates." << std::endl;
+        return 1;
+    }
+    for(size_t j = 0; j < top.size(); j++){
+        if(top[j].second < 19 || top[j].first % 20 != 19){
+            std::cout << "Error: TopK missed a heavy hitter." << std::endl;
+            return 1;
+        }
+    }
+
+    // Counters saturate instead of wrapping.
+    bloom::CountingBloomFilter<uint32_t> sat(2, 64);
+    for(int c = 0; c < 300; c++){
+        sat.Insert(42);
+    }
+    if(sat.EstimateCount(42) != 255){
+        std::cout << "Error: Counter did not saturate." << std::endl;
+        return 1;
+    }
+    sat.Delete(42);
+    if(!sat.Query(42)){
+        std::cout << "Error: Delete emptied a saturated counter." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Tests passed." << std::endl;
+    return 0;
+}
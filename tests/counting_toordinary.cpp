@@ -1,6 +1,8 @@
+#include <cstdint>
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include "CountingBloomFilter.hpp"
 #include "FnvHash.hpp"
 
@@ -53,6 +55,31 @@ int main(int argc, char *argv[]){
         return 1;
     }
     
+    // Counters convert bit for bit when their number is a multiple of 8.
+    bloom::CountingBloomFilter<uint32_t> cbf(3, 1000);
+    for(uint32_t i = 0; i < 100; i++){
+        cbf.Insert(i);
+    }
+    bloom::OrdinaryBloomFilter<uint32_t> obf = cbf.ToOrdinaryBloomFilter();
+    for(uint32_t i = 0; i < 100; i++){
+        if(!obf.Query(i)){
+            std::cout << "Error: Query for converted element was false." << std::endl;
+            return 1;
+        }
+    }
+
+    // Any other number would move the bits, so it is rejected.
+    bloom::CountingBloomFilter<uint32_t> odd(3, 1001);
+    for(uint32_t i = 0; i < 100; i++){
+        odd.Insert(i);
+    }
+    try {
+        odd.ToOrdinaryBloomFilter();
+        std::cout << "Error: Converted a BF whose size is not a multiple of 8." << std::endl;
+        return 1;
+    } catch(std::invalid_argument const&) {
+    }
+
     std::cout << "Tests passed." << std::endl;
     
     return 0;
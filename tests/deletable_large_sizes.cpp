@@ -0,0 +1,73 @@
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include "CountingBloomFilter.hpp"
+#include "PairedBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    // Well past the former 16-bit limit, and not a multiple of 8.
+    const size_t numBits = 3 * 65536 + 5;
+    const uint32_t numKeys = 20000;
+
+    bloom::CountingBloomFilter<uint32_t> cbf(5, numBits);
+    bloom::PairedBloomFilter<uint32_t> pbf(5, numBits);
+
+    if(cbf.GetNumBits() != numBits || pbf.GetNumBits() != numBits){
+        std::cout << "Error: Size was truncated." << std::endl;
+        return 1;
+    }
+
+    for(uint32_t i = 0; i < numKeys; i++){
+        cbf.Insert(i);
+        pbf.Insert(i);
+    }
+    for(uint32_t i = 0; i < numKeys; i += 2){
+        cbf.Delete(i);
+        pbf.Delete(i);
+    }
+
+    std::stringstream ss;
+    cbf.Serialize(ss);
+    pbf.Serialize(ss);
+
+    if(ss.str().size() != (1 + 8 + numBits) + (1 + 8 + (2 * numBits + 7) / 8)){
+        std::cout << "Error: Serialized size is wrong: " << ss.str().size() << std::endl;
+        return 1;
+    }
+
+    // Both read back from one stream, so neither may read past its end.
+    bloom::CountingBloomFilter<uint32_t> cbf_2 = bloom::CountingBloomFilter<uint32_t>::Deserialize(ss);
+    bloom::PairedBloomFilter<uint32_t> pbf_2 = bloom::PairedBloomFilter<uint32_t>::Deserialize(ss);
+
+    if(cbf_2.GetNumBits() != numBits || pbf_2.GetNumBits() != numBits){
+        std::cout << "Error: Deserialized BF disagrees on numBits." << std::endl;
+        return 1;
+    }
+
+    for(uint32_t i = 1; i < numKeys; i += 2){
+        if(!cbf_2.Query(i)){
+            std::cout << "Error: Query for inserted element was false." << std::endl;
+            return 1;
+        }
+    }
+    for(uint32_t i = 0; i < 2 * numKeys; i++){
+        if(cbf_2.Query(i) != cbf.Query(i) || pbf_2.Query(i) != pbf.Query(i)){
+            std::cout << "Error: Deserialized BF answers differently." << std::endl;
+            return 1;
+        }
+    }
+
+    std::stringstream again;
+    pbf_2.Serialize(again);
+    std::stringstream original;
+    pbf.Serialize(original);
+    if(again.str() != original.str()){
+        std::cout << "Error: Paired BF does not serialize identically after a round trip." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Tests passed." << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,408 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "OrdinaryBloomFilter.hpp"
+#include "ShardedBloomFilter.hpp"
+#include "StaticFilter.hpp"
+#include "TwoLevelBloomFilter.hpp"
+
+/** Differential tests: every fast path (batched, pipelined, SIMD, parallel,
+ *  encoded) is driven with random keys at realistic sizes and checked
+ *  against a bit-per-byte reference model built from ComputeHash alone.
+ *  With --throughput, the throughput of each path is also printed, and a
+ *  batched path running much slower than the scalar one it replaces fails
+ *  the run. Timings depend on the machine and its load, so only make fuzz
+ *  passes it; the default run is deterministic.
+ *
+ *  Usage: differential_fuzz [seed [rounds [--throughput]]]
+ */
+
+typedef bloom::OrdinaryBloomFilter<uint32_t> Filter;
+
+/** Batched paths may not take more than this multiple of the time of the
+ *  scalar loop they replace. Both are timed as the best of several runs so
+ *  that a loaded machine does not fail the run.
+ */
+const double MaxSlowdown = 2.0;
+
+/** The straightforward Bloom filter the library must agree with: one byte
+ *  per bit, positions taken directly from ComputeHash.
+ */
+struct Reference {
+
+    Reference(uint8_t numHashes, size_t numBytes, bloom::Layout layout)
+    : numHashes(numHashes), numBytes(numBytes), layout(layout), bits(8 * numBytes, 0)
+    {}
+
+    size_t Position(uint32_t o, uint8_t i) const {
+        size_t hash = bloom::AbstractBloomFilter<uint32_t>::ComputeHash(o, i);
+        if(layout == bloom::Layout::Partitioned){
+            size_t sliceBits = 8 * (numBytes / numHashes);
+            return i * sliceBits + hash % sliceBits;
+        }
+        return hash % (8 * numBytes);
+    }
+
+    void Insert(uint32_t o) {
+        for(uint8_t i = 0; i < numHashes; i++){
+            bits[Position(o, i)] = 1;
+        }
+    }
+
+    bool Query(uint32_t o) const {
+        for(uint8_t i = 0; i < numHashes; i++){
+            if(!bits[Position(o, i)]){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Matches(const unsigned char *bitarray) const {
+        for(size_t b = 0; b < bits.size(); b++){
+            if(((bitarray[b / 8] >> (b % 8)) & 1) != bits[b]){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint8_t numHashes;
+    size_t numBytes;
+    bloom::Layout layout;
+    std::vector<uint8_t> bits;
+};
+
+template <typename F>
+double BestSeconds(F f, int runs = 5) {
+    double best = 1e30;
+    for(int r = 0; r < runs; r++){
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+        best = std::min(best, d.count());
+    }
+    return best;
+}
+
+void Report(const char *path, size_t n, double seconds) {
+    std::cout << "  " << path << ": " << n / seconds / 1e6 << " Mkeys/s" << std::endl;
+}
+
+std::vector<uint32_t> RandomKeys(std::mt19937& rng, size_t n) {
+    std::vector<uint32_t> keys(n);
+    for(size_t i = 0; i < n; i++){
+        keys[i] = rng();
+    }
+    return keys;
+}
+
+template <typename A, typename B>
+bool SameBits(A const& a, B const& b) {
+    return a.GetnumBytes() == b.GetnumBytes() && std::equal(a.Data(), a.Data() + a.GetnumBytes(), b.Data());
+}
+
+/** One round on a random shape: every path must reproduce the reference.
+ */
+bool CheckOrdinary(std::mt19937& rng, uint8_t numHashes, size_t numBytes, bloom::Layout layout, size_t numKeys) {
+    std::vector<uint32_t> keys = RandomKeys(rng, numKeys);
+    std::vector<uint32_t> probes = RandomKeys(rng, numKeys);
+
+    Reference ref(numHashes, numBytes, layout);
+    Filter bf(numHashes, numBytes, layout);
+    for(size_t i = 0; i < keys.size(); i++){
+        ref.Insert(keys[i]);
+        bf.Insert(keys[i]);
+    }
+    if(!ref.Matches(bf.Data())){
+        std::cout << "Error: Insert disagrees with the reference bit array." << std::endl;
+        return false;
+    }
+
+    // Scalar, pipelined and SIMD probe paths against the reference.
+    std::vector<uint32_t> all(keys);
+    all.insert(all.end(), probes.begin(), probes.end());
+    std::unique_ptr<bool[]> batch(new bool[all.size()]);
+    bf.QueryBatch(all.data(), all.size(), batch.get());
+    for(size_t i = 0; i < all.size(); i++){
+        bool expected = ref.Query(all[i]);
+        if(i < keys.size() && !expected){
+            std::cout << "Error: Reference lost an inserted element." << std::endl;
+            return false;
+        }
+        if(bf.Query(all[i]) != expected || batch[i] != expected){
+            std::cout << "Error: Query paths disagree with the reference." << std::endl;
+            return false;
+        }
+        size_t pos[256];
+        for(uint8_t h = 0; h < numHashes; h++){
+            pos[h] = bf.GetBitIndex(all[i], h);
+        }
+        if(bloom::bits::TestBits(bf.Data(), numBytes, pos, numHashes) != expected){
+            std::cout << "Error: TestBits disagrees with the reference." << std::endl;
+            return false;
+        }
+    }
+
+    // Union of two halves equals the whole.
+    Filter lo(numHashes, numBytes, layout), hi(numHashes, numBytes, layout);
+    for(size_t i = 0; i < keys.size(); i++){
+        (i % 2 ? hi : lo).Insert(keys[i]);
+    }
+    lo.Union(hi);
+    if(!SameBits(lo, bf)){
+        std::cout << "Error: Union of halves differs from the whole." << std::endl;
+        return false;
+    }
+
+    // Every serialized form round-trips bit for bit.
+    std::stringstream raw, encoded, delta;
+    bf.Serialize(raw);
+    if(!SameBits(Filter::Deserialize(raw), bf)){
+        std::cout << "Error: Serialize round trip changed the bit array." << std::endl;
+        return false;
+    }
+    bf.SerializeEncoded(encoded);
+    Filter decoded = Filter::DeserializeEncoded(encoded);
+    if(!SameBits(decoded, bf) || decoded.GetLayout() != layout){
+        std::cout << "Error: SerializeEncoded round trip changed the filter." << std::endl;
+        return false;
+    }
+    Filter empty(numHashes, numBytes, layout);
+    bf.SerializeDelta(empty, delta);
+    empty.ApplyDelta(delta);
+    if(!SameBits(empty, bf)){
+        std::cout << "Error: Delta round trip changed the bit array." << std::endl;
+        return false;
+    }
+
+    // Compress keeps every member, with or without the fused path.
+    if(numBytes % (2 * numHashes) == 0){
+        Filter small = bf.Compress();
+        for(size_t i = 0; i < keys.size(); i++){
+            if(!small.Query(keys[i])){
+                std::cout << "Error: Compressed BF lost an inserted element." << std::endl;
+                return false;
+            }
+        }
+        std::stringstream expected, fused;
+        small.SerializeEncoded(expected);
+        bf.SerializeCompressed(fused, 2, true);
+        if(expected.str() != fused.str()){
+            std::cout << "Error: Fused compress and serialize differs from Compress." << std::endl;
+            return false;
+        }
+    }
+
+    if(layout == bloom::Layout::Standard){
+        // A parallel build through the static index, as the tools do.
+        Filter par(numHashes, numBytes);
+        unsigned char *out = par.Get_bloom().data();
+        std::vector<std::thread> workers;
+        for(unsigned t = 0; t < 4; t++){
+            workers.emplace_back([&keys, out, numHashes, numBytes, t](){
+                for(size_t i = t; i < keys.size(); i += 4){
+                    for(uint8_t h = 0; h < numHashes; h++){
+                        size_t b = Filter::BitIndex(keys[i], h, numBytes);
+                        __atomic_fetch_or(&out[b / 8], (unsigned char) (1u << (b % 8)), __ATOMIC_RELAXED);
+                    }
+                }
+            });
+        }
+        for(size_t t = 0; t < workers.size(); t++){
+            workers[t].join();
+        }
+        if(!SameBits(par, bf)){
+            std::cout << "Error: Parallel build differs from sequential inserts." << std::endl;
+            return false;
+        }
+
+        // Conversions answer like their source, also after a round trip.
+        bloom::PairedBloomFilter<uint32_t> paired = bf.ToPairedBloomFilter();
+        for(size_t i = 0; i < all.size(); i++){
+            if(paired.Query(all[i]) != batch[i]){
+                std::cout << "Error: Paired conversion answers differently." << std::endl;
+                return false;
+            }
+        }
+        for(size_t i = 0; i < keys.size(); i += 3){
+            paired.Delete(keys[i]);
+        }
+        std::stringstream pairedBytes;
+        paired.Serialize(pairedBytes);
+        bloom::PairedBloomFilter<uint32_t> paired_2 = bloom::PairedBloomFilter<uint32_t>::Deserialize(pairedBytes);
+        for(size_t i = 0; i < all.size(); i++){
+            if(paired_2.Query(all[i]) != paired.Query(all[i])){
+                std::cout << "Error: Paired round trip answers differently." << std::endl;
+                return false;
+            }
+        }
+
+        bloom::CountingBloomFilter<uint32_t> counting(numHashes, 8 * numBytes);
+        for(size_t i = 0; i < keys.size(); i++){
+            counting.Insert(keys[i]);
+        }
+        if(!SameBits(counting.ToOrdinaryBloomFilter(), bf)){
+            std::cout << "Error: Counting BF packs to a different bit array." << std::endl;
+            return false;
+        }
+        std::stringstream countingBytes;
+        counting.Serialize(countingBytes);
+        bloom::CountingBloomFilter<uint32_t> counting_2 = bloom::CountingBloomFilter<uint32_t>::Deserialize(countingBytes);
+        std::unique_ptr<uint8_t[]> counts(new uint8_t[all.size()]);
+        counting_2.EstimateCountBatch(all.data(), all.size(), counts.get());
+        for(size_t i = 0; i < all.size(); i++){
+            if(counts[i] != counting.EstimateCount(all[i]) || (counts[i] != 0) != batch[i]){
+                std::cout << "Error: Count estimate paths disagree." << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/** Sharded, two-level and static filters against plain ones.
+ */
+bool CheckComposites(std::mt19937& rng, size_t numKeys) {
+    std::vector<uint32_t> keys = RandomKeys(rng, numKeys);
+    std::vector<uint32_t> probes = RandomKeys(rng, numKeys);
+
+    bloom::ShardedBloomFilter<uint32_t> single(6, 1 << 18, 8), batched(6, 1 << 18, 8);
+    for(size_t i = 0; i < keys.size(); i++){
+        single.Insert(keys[i]);
+    }
+    batched.InsertBatch(keys.data(), keys.size());
+    for(size_t s = 0; s < single.GetNumShards(); s++){
+        if(!SameBits(single.GetShard(s), batched.GetShard(s))){
+            std::cout << "Error: Sharded InsertBatch differs from Insert." << std::endl;
+            return false;
+        }
+    }
+
+    bloom::TwoLevelBloomFilter<uint32_t> two(6, 1 << 18, 1 << 12, 2);
+    for(size_t i = 0; i < keys.size(); i++){
+        two.Insert(keys[i]);
+    }
+    for(size_t i = 0; i < probes.size(); i++){
+        bool expected = two.GetMain().Query(probes[i]) && two.GetSummary().Query(probes[i]);
+        if(two.Query(probes[i]) != expected || (i < keys.size() && !two.Query(keys[i]))){
+            std::cout << "Error: Two-level query disagrees with its levels." << std::endl;
+            return false;
+        }
+    }
+
+    typedef bloom::StaticFilter<uint32_t> Static;
+    std::stringstream one, four;
+    Static::Build(keys.data(), keys.size(), 1).Serialize(one);
+    Static::Build(keys.data(), keys.size(), 4).Serialize(four);
+    if(one.str() != four.str()){
+        std::cout << "Error: Parallel static build differs from sequential." << std::endl;
+        return false;
+    }
+    Static sf = Static::Deserialize(one);
+    for(size_t i = 0; i < keys.size(); i++){
+        if(!sf.Query(keys[i])){
+            std::cout << "Error: Static filter lost an inserted element." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Times the scalar and batched paths on a filter larger than the caches.
+ */
+bool CheckThroughput(std::mt19937& rng) {
+    const size_t numKeys = 1 << 18;
+    std::vector<uint32_t> keys = RandomKeys(rng, numKeys);
+    Filter bf(7, 1 << 23);
+    std::unique_ptr<bool[]> results(new bool[numKeys]);
+    size_t sink = 0;
+
+    double insert = BestSeconds([&](){
+        for(size_t i = 0; i < numKeys; i++){
+            bf.Insert(keys[i]);
+        }
+    }, 1);
+    double scalar = BestSeconds([&](){
+        for(size_t i = 0; i < numKeys; i++){
+            sink += bf.Query(keys[i] ^ 1);
+        }
+    });
+    double batch = BestSeconds([&](){
+        bf.QueryBatch(keys.data(), numKeys, results.get());
+    });
+
+    bloom::CountingBloomFilter<uint32_t> counting(7, 1 << 23);
+    for(size_t i = 0; i < numKeys; i += 16){
+        counting.Insert(keys[i]);
+    }
+    std::unique_ptr<uint8_t[]> counts(new uint8_t[numKeys]);
+    double countScalar = BestSeconds([&](){
+        for(size_t i = 0; i < numKeys; i++){
+            sink += counting.EstimateCount(keys[i]);
+        }
+    });
+    double countBatch = BestSeconds([&](){
+        counting.EstimateCountBatch(keys.data(), numKeys, counts.get());
+    });
+
+    std::cout << "Throughput (" << sink % 2 << "):" << std::endl;
+    Report("Insert", numKeys, insert);
+    Report("Query", numKeys, scalar);
+    Report("QueryBatch", numKeys, batch);
+    Report("EstimateCount", numKeys, countScalar);
+    Report("EstimateCountBatch", numKeys, countBatch);
+
+    if(batch > MaxSlowdown * scalar){
+        std::cout << "Error: QueryBatch is slower than scalar queries." << std::endl;
+        return false;
+    }
+    if(countBatch > MaxSlowdown * countScalar){
+        std::cout << "Error: EstimateCountBatch is slower than scalar estimates." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]){
+
+    unsigned long seed = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 20240611;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 12;
+    bool throughput = argc > 3 && std::string(argv[3]) == "--throughput";
+    std::mt19937 rng(seed);
+    std::cout << "Seed " << seed << ", " << rounds << " rounds." << std::endl;
+
+    for(int r = 0; r < rounds; r++){
+        uint8_t numHashes = (uint8_t) (1 + rng() % 16);
+        size_t numBytes = std::max<size_t>(numHashes, 1 + rng() % (1 << (8 + rng() % 12)));
+        size_t numKeys = 1 + rng() % (numBytes / 2 + 1);
+        bloom::Layout layout = rng() % 2 ? bloom::Layout::Partitioned : bloom::Layout::Standard;
+        if(!CheckOrdinary(rng, numHashes, numBytes, layout, numKeys)){
+            std::cout << "Failed shape: " << (int) numHashes << " hashes, " << numBytes << " bytes, "
+                      << numKeys << " keys, layout " << (int) layout << std::endl;
+            return 1;
+        }
+    }
+
+    // Fixed shapes covering the SIMD tails and a realistic size.
+    if(!CheckOrdinary(rng, 8, 40, bloom::Layout::Standard, 20)
+       || !CheckOrdinary(rng, 9, 8191, bloom::Layout::Standard, 4000)
+       || !CheckOrdinary(rng, 7, 1 << 21, bloom::Layout::Standard, 1 << 18)
+       || !CheckOrdinary(rng, 7, 1 << 21, bloom::Layout::Partitioned, 1 << 18)){
+        return 1;
+    }
+
+    if(!CheckComposites(rng, 50000) || (throughput && !CheckThroughput(rng))){
+        return 1;
+    }
+
+    std::cout << "Tests passed." << std::endl;
+
+    return 0;
+}
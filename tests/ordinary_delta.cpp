@@ -0,0 +1,108 @@
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "OrdinaryBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    const size_t numBytes = (1 << 16) + 3;
+    
+    bloom::OrdinaryBloomFilter<uint32_t> sender(4, numBytes);
+    sender.TrackChanges(true);
+    for(uint32_t i = 0; i < 5000; i++){
+        sender.Insert(i);
+    }
+    
+    std::stringstream full;
+    sender.Serialize(full);
+    bloom::OrdinaryBloomFilter<uint32_t> receiver = bloom::OrdinaryBloomFilter<uint32_t>::Deserialize(full);
+    bloom::OrdinaryBloomFilter<uint32_t> previous = receiver;
+    
+    // Forget the changes already shipped by the full copy.
+    std::stringstream discard;
+    sender.SerializeDelta(discard);
+    
+    for(uint32_t i = 5000; i < 5200; i++){
+        sender.Insert(i);
+    }
+    
+    std::stringstream delta;
+    size_t changed = sender.SerializeDelta(delta);
+    
+    if(changed == 0 || changed > 800 || delta.str().size() > 10 * changed + 32){
+        std::cout << "Error: Delta has unexpected size (" << changed << " words)." << std::endl;
+        return 1;
+    }
+    
+    receiver.ApplyDelta(delta);
+    if(std::memcmp(receiver.Data(), sender.Data(), numBytes) != 0){
+        std::cout << "Error: Tracked delta did not reproduce the sender." << std::endl;
+        return 1;
+    }
+    
+    std::stringstream scanned;
+    size_t changed_2 = sender.SerializeDelta(previous, scanned);
+    if(changed_2 != changed){
+        std::cout << "Error: Scanned delta disagrees with tracked delta." << std::endl;
+        return 1;
+    }
+    previous.ApplyDelta(scanned);
+    if(std::memcmp(previous.Data(), sender.Data(), numBytes) != 0){
+        std::cout << "Error: Scanned delta did not reproduce the sender." << std::endl;
+        return 1;
+    }
+    
+    std::stringstream empty;
+    if(sender.SerializeDelta(empty) != 0){
+        std::cout << "Error: Delta was not reset after serialization." << std::endl;
+        return 1;
+    }
+    
+    // Deltas for another shape, naming words past the end or cut short are
+    // rejected without touching the receiver.
+    bloom::OrdinaryBloomFilter<uint32_t> smaller(4, 64), otherHashes(5, numBytes);
+    smaller.TrackChanges(true);
+    smaller.Insert(1);
+    std::stringstream smallDelta;
+    smaller.SerializeDelta(smallDelta);
+    std::string oversized = smallDelta.str();
+    std::stringstream bigDelta;
+    sender.SerializeDelta(bloom::OrdinaryBloomFilter<uint32_t>(4, numBytes), bigDelta);
+    std::string truncated = bigDelta.str();
+    truncated.resize(truncated.size() - 1);
+    std::string outOfRange = bigDelta.str();
+    uint64_t one = 1;
+    outOfRange.replace(sizeof(uint8_t) + sizeof(size_t), sizeof(uint64_t), (const char *) &one, sizeof(uint64_t));
+    outOfRange.resize(sizeof(uint8_t) + sizeof(size_t) + sizeof(uint64_t));
+    outOfRange += "\xff\xff\xff\x7f";
+    outOfRange += std::string(8, '\xff');
+
+    const std::string bad[] = { oversized, truncated, outOfRange, bigDelta.str() };
+    const std::string before((const char *) previous.Data(), numBytes);
+    for(int i = 0; i < 4; i++){
+        std::stringstream is(bad[i]);
+        try {
+            (i < 3 ? previous : otherHashes).ApplyDelta(is);
+            std::cout << "Error: Invalid delta " << i << " was applied." << std::endl;
+            return 1;
+        } catch(std::invalid_argument const&) {
+        }
+        if(std::string((const char *) previous.Data(), numBytes) != before){
+            std::cout << "Error: Rejected delta changed the filter." << std::endl;
+            return 1;
+        }
+    }
+    try {
+        std::stringstream os;
+        sender.SerializeDelta(smaller, os);
+        std::cout << "Error: Delta against a filter of another size was written." << std::endl;
+        return 1;
+    } catch(std::invalid_argument const&) {
+    }
+
+    std::cout << "Tests passed." << std::endl;
+    
+    return 0;
+}
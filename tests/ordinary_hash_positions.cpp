@@ -0,0 +1,51 @@
+#include <string>
+#include <iostream>
+#include "OrdinaryBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    bloom::OrdinaryBloomFilter<uint32_t> bf(7, 1 << 12);
+    
+    const size_t n = 1000;
+    uint32_t keys[n];
+    uint64_t fps[n];
+    for(uint32_t i = 0; i < n; i++){
+        keys[i] = i;
+    }
+    bf.HashFingerprintBatch(keys, n, fps);
+    
+    for(uint32_t i = 0; i < n; i++){
+        size_t pos[7];
+        bf.HashPositions(keys[i], pos);
+        
+        std::string expected = "";
+        for(int j = 0; j < 7; j++){
+            if(j > 0 && pos[j-1] > pos[j]){
+                std::cout << "Error: Hash positions are not sorted." << std::endl;
+                return 1;
+            }
+            expected += std::to_string(pos[j]);
+        }
+        
+        if(bf.Hash(keys[i]) != expected){
+            std::cout << "Error: Hash string disagrees with hash positions." << std::endl;
+            return 1;
+        }
+        
+        if(fps[i] != bf.HashFingerprint(keys[i])){
+            std::cout << "Error: Batched fingerprint disagrees with single one." << std::endl;
+            return 1;
+        }
+        
+        for(uint32_t j = 0; j < i; j++){
+            if(fps[i] == fps[j] && bf.Hash(keys[i]) != bf.Hash(keys[j])){
+                std::cout << "Error: Fingerprint collision for different positions." << std::endl;
+                return 1;
+            }
+        }
+    }
+    
+    std::cout << "Tests passed." << std::endl;
+    
+    return 0;
+}
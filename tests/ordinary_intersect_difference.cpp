@@ -0,0 +1,59 @@
+#include <cmath>
+#include <iostream>
+#include "OrdinaryBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    // A = [0, 3000), B = [2000, 5000): |A n B| = 1000, |A u B| = 5000.
+    bloom::OrdinaryBloomFilter<uint32_t> a(4, (1 << 14) + 5);
+    bloom::OrdinaryBloomFilter<uint32_t> b(4, (1 << 14) + 5);
+    for(uint32_t i = 0; i < 3000; i++){
+        a.Insert(i);
+        b.Insert(i + 2000);
+    }
+    
+    size_t andCount = a.IntersectCount(b);
+    size_t andNotCount = a.DifferenceCount(b);
+    size_t orCount = a.UnionCount(b);
+    
+    if(andCount + andNotCount != a.CountBits() || orCount != b.CountBits() + andNotCount){
+        std::cout << "Error: Fused counts are inconsistent." << std::endl;
+        return 1;
+    }
+    
+    double j = a.Jaccard(b);
+    if(std::fabs(j - 0.2) > 0.03){
+        std::cout << "Error: Jaccard estimate " << j << " is far from 0.2." << std::endl;
+        return 1;
+    }
+    
+    bloom::OrdinaryBloomFilter<uint32_t> both = a;
+    both.Intersect(b);
+    if(both.CountBits() != andCount){
+        std::cout << "Error: Intersect disagrees with IntersectCount." << std::endl;
+        return 1;
+    }
+    for(uint32_t i = 2000; i < 3000; i++){
+        if(!both.Query(i)){
+            std::cout << "Error: Query for element of the intersection was false." << std::endl;
+            return 1;
+        }
+    }
+    
+    bloom::OrdinaryBloomFilter<uint32_t> onlyA = a;
+    onlyA.Difference(b);
+    if(onlyA.CountBits() != andNotCount){
+        std::cout << "Error: Difference disagrees with DifferenceCount." << std::endl;
+        return 1;
+    }
+    for(uint32_t i = 2000; i < 5000; i++){
+        if(onlyA.Query(i)){
+            std::cout << "Error: Query for element of B was true after Difference." << std::endl;
+            return 1;
+        }
+    }
+    
+    std::cout << "Tests passed." << std::endl;
+    
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include "LargePageAllocator.hpp"
+#include "ReplicatedBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    typedef bloom::LargePageAllocator<unsigned char> Alloc;
+    
+    // Large enough to take the huge-page mapping path.
+    bloom::OrdinaryBloomFilter<uint32_t, Alloc> bf(4, 4 * Alloc::HugePageSize,
+        Alloc(bloom::PagePolicy::TransparentHuge, bloom::NumaPolicy::Interleave));
+    bloom::OrdinaryBloomFilter<uint32_t> ref(4, 4 * Alloc::HugePageSize);
+    
+    if(((uintptr_t) bf.Data()) % Alloc::HugePageSize != 0){
+        std::cout << "Error: Large bit array is not huge-page aligned." << std::endl;
+        return 1;
+    }
+    
+    for(uint32_t i = 0; i < 1000; i++){
+        bf.Insert(i);
+        ref.Insert(i);
+    }
+    
+    for(uint32_t i = 0; i < 2000; i++){
+        if(bf.Query(i) != ref.Query(i)){
+            std::cout << "Error: Huge-page BF disagrees with default BF." << std::endl;
+            return 1;
+        }
+    }
+    
+    // Small arrays fall back to aligned heap memory.
+    bloom::OrdinaryBloomFilter<uint32_t, Alloc> small(4, 32, Alloc(bloom::PagePolicy::ExplicitHuge));
+    small.Insert(7);
+    if(!small.Query(7) || ((uintptr_t) small.Data()) % Alloc::Alignment != 0){
+        std::cout << "Error: Small huge-page-policy BF is broken or misaligned." << std::endl;
+        return 1;
+    }
+    
+    bloom::ReplicatedBloomFilter<uint32_t> rep(ref);
+    rep.Insert(5000);
+    
+    if(rep.GetNumReplicas() < 1 || !rep.Query(999) || !rep.Query(5000)){
+        std::cout << "Error: Query on local replica was false." << std::endl;
+        return 1;
+    }
+    
+    for(size_t n = 0; n < rep.GetNumReplicas(); n++){
+        if(!rep.GetReplica(n).Query(5000)){
+            std::cout << "Error: Insert did not reach every replica." << std::endl;
+            return 1;
+        }
+    }
+    
+    // Replicas of a partitioned filter probe the same slices.
+    bloom::OrdinaryBloomFilter<uint32_t> partitioned(4, 4096 + 3, bloom::Layout::Partitioned);
+    for(uint32_t i = 0; i < 500; i++){
+        partitioned.Insert(i);
+    }
+    bloom::ReplicatedBloomFilter<uint32_t> repPartitioned(partitioned);
+    for(uint32_t i = 0; i < 2000; i++){
+        if(repPartitioned.Query(i) != partitioned.Query(i)
+           || repPartitioned.GetReplica(0).GetLayout() != bloom::Layout::Partitioned){
+            std::cout << "Error: Replica of a partitioned BF disagrees with it." << std::endl;
+            return 1;
+        }
+    }
+    
+    std::cout << "Tests passed." << std::endl;
+    
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include "OrdinaryBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    const uint8_t numHashes = 4;
+    const size_t numBytes = 4 * 1024 + 3;
+
+    bloom::OrdinaryBloomFilter<uint32_t> bf(numHashes, numBytes, bloom::Layout::Partitioned);
+
+    if(bf.GetLayout() != bloom::Layout::Partitioned || bf.GetSliceBytes() != 1024){
+        std::cout << "Error: Partitioned BF has the wrong slices." << std::endl;
+        return 1;
+    }
+
+    for(uint32_t i = 0; i < 1000; i++){
+        bf.Insert(i);
+    }
+
+    for(uint32_t i = 0; i < 1000; i++){
+        for(uint8_t h = 0; h < numHashes; h++){
+            size_t pos = bf.GetBitIndex(i, h);
+            if(pos / 8 / bf.GetSliceBytes() != h){
+                std::cout << "Error: Hash " << (int) h << " left its slice." << std::endl;
+                return 1;
+            }
+        }
+        if(!bf.Query(i)){
+            std::cout << "Error: Query for inserted element was false." << std::endl;
+            return 1;
+        }
+    }
+
+    for(size_t i = numHashes * bf.GetSliceBytes(); i < numBytes; i++){
+        if(bf.Get_bloom()[i] != 0){
+            std::cout << "Error: Bytes past the last slice were written." << std::endl;
+            return 1;
+        }
+    }
+
+    size_t falsePositives = 0;
+    for(uint32_t i = 1000; i < 11000; i++){
+        falsePositives += bf.Query(i);
+    }
+    if(falsePositives > 500){
+        std::cout << "Error: Too many false positives: " << falsePositives << std::endl;
+        return 1;
+    }
+
+    std::stringstream ss;
+    bf.Serialize(ss);
+    bloom::OrdinaryBloomFilter<uint32_t> bf_2 = bloom::OrdinaryBloomFilter<uint32_t>::Deserialize(ss);
+
+    if(bf_2.GetLayout() != bloom::Layout::Partitioned || bf_2.GetnumBytes() != numBytes){
+        std::cout << "Error: Deserialized BF lost its shape." << std::endl;
+        return 1;
+    }
+    for(uint32_t i = 1000; i < 11000; i++){
+        if(bf_2.Query(i) != bf.Query(i)){
+            std::cout << "Error: Deserialized BF answers differently." << std::endl;
+            return 1;
+        }
+    }
+
+    std::stringstream standard;
+    bloom::OrdinaryBloomFilter<uint32_t>(numHashes, numBytes).Serialize(standard);
+    if(bloom::OrdinaryBloomFilter<uint32_t>::Deserialize(standard).GetLayout() != bloom::Layout::Standard){
+        std::cout << "Error: Standard BF deserialized as partitioned." << std::endl;
+        return 1;
+    }
+
+    bloom::OrdinaryBloomFilter<uint32_t> bf_3 = bf.Compress();
+
+    if(bf_3.GetLayout() != bloom::Layout::Partitioned || bf_3.GetSliceBytes() != 512
+       || bf_3.GetnumBytes() != numHashes * 512){
+        std::cout << "Error: Compressed BF has the wrong slices." << std::endl;
+        return 1;
+    }
+    for(uint32_t i = 0; i < 1000; i++){
+        if(!bf_3.Query(i)){
+            std::cout << "Error: Query on compressed BF for inserted element was false." << std::endl;
+            return 1;
+        }
+    }
+
+    // Slices must hold at least one byte, whether built or deserialized.
+    bool thrown = false;
+    try {
+        bloom::OrdinaryBloomFilter<uint32_t> tiny(numHashes, numHashes - 1, bloom::Layout::Partitioned);
+    } catch(std::invalid_argument const&) {
+        thrown = true;
+    }
+    std::stringstream tinyHeader;
+    size_t header = (numHashes - 1) | ~(~(size_t) 0 >> 1);
+    tinyHeader.write((const char *) &numHashes, sizeof(uint8_t));
+    tinyHeader.write((const char *) &header, sizeof(size_t));
+    tinyHeader.write("\0\0\0", numHashes - 1);
+    try {
+        bloom::OrdinaryBloomFilter<uint32_t>::Deserialize(tinyHeader);
+        thrown = false;
+    } catch(std::invalid_argument const&) {
+    }
+    if(!thrown){
+        std::cout << "Error: Partitioned BF with empty slices was accepted." << std::endl;
+        return 1;
+    }
+
+    // Partitioned and standard BFs set different bits for the same object.
+    bloom::OrdinaryBloomFilter<uint32_t> plain(numHashes, numBytes);
+    const char *rejected[] = { "Union", "IntersectCount", "ToPaired", "ToCounting" };
+    for(int op = 0; op < 4; op++){
+        try {
+            switch(op){
+                case 0: bf.Union(plain); break;
+                case 1: bf.IntersectCount(plain); break;
+                case 2: bf.ToPairedBloomFilter(); break;
+                case 3: bf.ToCountingBloomFilter(); break;
+            }
+            std::cout << "Error: " << rejected[op] << " accepted a partitioned BF." << std::endl;
+            return 1;
+        } catch(std::invalid_argument const&) {
+        }
+    }
+    bloom::OrdinaryBloomFilter<uint32_t> fewerSlices(numHashes - 1, numBytes, bloom::Layout::Partitioned);
+    try {
+        bf.Intersect(fewerSlices);
+        std::cout << "Error: Intersect accepted a BF with other slices." << std::endl;
+        return 1;
+    } catch(std::invalid_argument const&) {
+    }
+
+    std::cout << "Tests passed." << std::endl;
+
+    return 0;
+}
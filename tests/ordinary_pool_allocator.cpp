@@ -0,0 +1,96 @@
+#include <iostream>
+#include <sstream>
+#include "OrdinaryBloomFilter.hpp"
+#include "PoolAllocator.hpp"
+
+typedef bloom::OrdinaryBloomFilter<uint32_t, bloom::PoolAllocator<unsigned char>> PooledFilter;
+typedef bloom::CountingBloomFilter<uint32_t, bloom::PoolAllocator<uint8_t>> PooledCounting;
+
+int main(int argc, char *argv[]){
+
+    bloom::BitArrayPool pool;
+    bloom::PoolAllocator<unsigned char> alloc(pool);
+
+    const unsigned char *first;
+    {
+        PooledFilter bf(4, 4096, alloc);
+        for(uint32_t i = 0; i < 500; i++){
+            bf.Insert(i);
+        }
+        first = bf.Data();
+    }
+    if(pool.GetNumCached() != 1){
+        std::cout << "Error: Freed bit array was not cached." << std::endl;
+        return 1;
+    }
+
+    // A filter of the same size reuses the array, and starts empty.
+    PooledFilter bf(4, 4096, alloc);
+    if(bf.Data() != first || pool.GetNumCached() != 0){
+        std::cout << "Error: Cached bit array was not reused." << std::endl;
+        return 1;
+    }
+    if(bf.CountBits() != 0){
+        std::cout << "Error: Recycled bit array was not zeroed." << std::endl;
+        return 1;
+    }
+
+    for(uint32_t i = 0; i < 500; i++){
+        bf.Insert(i);
+    }
+
+    // Per-step temporaries come from the same pool.
+    for(int step = 0; step < 10; step++){
+        PooledFilter half = bf.Compress();
+        std::stringstream ss;
+        bf.Serialize(ss);
+        PooledFilter copy = PooledFilter::Deserialize(ss, alloc);
+        if(&half.Get_bloom().get_allocator().GetPool() != &pool || copy.Data() == bf.Data()){
+            std::cout << "Error: Temporary filter did not use the pool." << std::endl;
+            return 1;
+        }
+        for(uint32_t i = 0; i < 500; i++){
+            if(!half.Query(i) || !copy.Query(i)){
+                std::cout << "Error: Query for inserted element was false." << std::endl;
+                return 1;
+            }
+        }
+    }
+    if(pool.GetNumCached() != 2){
+        std::cout << "Error: Temporaries were not returned to the pool." << std::endl;
+        return 1;
+    }
+
+    PooledCounting cbf(4, 8192, bloom::PoolAllocator<uint8_t>(pool));
+    for(uint32_t i = 0; i < 500; i++){
+        cbf.Insert(i);
+    }
+    PooledFilter converted = cbf.ToOrdinaryBloomFilter();
+    for(uint32_t i = 0; i < 500; i++){
+        if(!converted.Query(i)){
+            std::cout << "Error: Query for element of converted filter was false." << std::endl;
+            return 1;
+        }
+    }
+    cbf.Clear();
+    for(uint32_t i = 0; i < 500; i++){
+        if(cbf.Query(i)){
+            std::cout << "Error: Cleared counting filter still holds an element." << std::endl;
+            return 1;
+        }
+    }
+
+    // Large enough to be zeroed with streaming stores.
+    PooledFilter large(4, 3 << 20, alloc);
+    for(uint32_t i = 0; i < 100000; i++){
+        large.Insert(i);
+    }
+    large.Clear();
+    if(large.CountBits() != 0){
+        std::cout << "Error: Clear left bits set." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Tests passed." << std::endl;
+    return 0;
+}
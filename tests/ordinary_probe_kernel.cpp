@@ -0,0 +1,70 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "OrdinaryBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    // The branch-free kernel must agree with a bit-by-bit test for every
+    // array size (including ones not a multiple of the gather width) and
+    // every number of positions.
+    srand(1);
+    for(size_t numBytes = 1; numBytes < 80; numBytes++){
+        std::vector<unsigned char> bits(numBytes);
+        for(size_t b = 0; b < numBytes; b++){
+            bits[b] = (unsigned char) (rand() | rand());
+        }
+        for(unsigned k = 0; k <= 20; k++){
+            for(int trial = 0; trial < 20; trial++){
+                size_t pos[20];
+                bool expected = true;
+                for(unsigned i = 0; i < k; i++){
+                    pos[i] = rand() % (8 * numBytes);
+                    expected = expected && ((bits[pos[i] / 8] >> (pos[i] % 8)) & 1);
+                }
+                if(bloom::bits::TestBits(bits.data(), numBytes, pos, k) != expected){
+                    std::cout << "Error: TestBits disagrees with bit-by-bit test." << std::endl;
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // Query, QueryBatch and the paired halves agree with inserted contents.
+    bloom::OrdinaryBloomFilter<uint32_t> bf(11, 1003);
+    for(uint32_t i = 0; i < 300; i++){
+        bf.Insert(i);
+    }
+    std::vector<uint32_t> keys;
+    for(uint32_t i = 0; i < 3000; i++){
+        keys.push_back(i);
+    }
+    std::vector<char> batch(keys.size());
+    bf.QueryBatch(keys.data(), keys.size(), (bool *) batch.data());
+
+    bloom::PairedBloomFilter<uint32_t> pbf = bf.ToPairedBloomFilter();
+    pbf.Delete(5);
+
+    for(uint32_t i = 0; i < 3000; i++){
+        bool present = bf.Query(i);
+        if(i < 300 && !present){
+            std::cout << "Error: Query for inserted element was false." << std::endl;
+            return 1;
+        }
+        if((bool) batch[i] != present){
+            std::cout << "Error: QueryBatch disagrees with Query." << std::endl;
+            return 1;
+        }
+        if(!present && pbf.Query(i)){
+            std::cout << "Error: Paired BF holds an element its source does not." << std::endl;
+            return 1;
+        }
+    }
+    if(pbf.Query(5)){
+        std::cout << "Error: Query for deleted element was true." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <vector>
+#include <iostream>
+#include "OrdinaryBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    bloom::OrdinaryBloomFilter<uint32_t> bf(4, 1 << 16);
+    
+    std::vector<uint32_t> keys;
+    for(uint32_t i = 0; i < 20000; i++){
+        keys.push_back(i * 2654435761u);
+        if(i % 2 == 0){
+            bf.Insert(keys.back());
+        }
+    }
+    
+    bool *results = new bool[keys.size()];
+    bf.QueryBatch(keys.data(), keys.size(), results);
+    
+    for(size_t i = 0; i < keys.size(); i++){
+        if(results[i] != bf.Query(keys[i])){
+            std::cout << "Error: Batched query disagrees with Query for key " << i << "." << std::endl;
+            delete[] results;
+            return 1;
+        }
+        if(i % 2 == 0 && !results[i]){
+            std::cout << "Error: Batched query for inserted element was false." << std::endl;
+            delete[] results;
+            return 1;
+        }
+    }
+    delete[] results;
+    
+    size_t seen = 0;
+    bool ordered = true;
+    bf.QueryStream(keys.begin(), keys.end(), [&](uint32_t const& o, bool present){
+        if(o != keys[seen] || present != bf.Query(o)){
+            ordered = false;
+        }
+        seen++;
+    });
+    
+    if(!ordered || seen != keys.size()){
+        std::cout << "Error: Streamed query results out of order or wrong." << std::endl;
+        return 1;
+    }
+    
+    std::cout << "Tests passed." << std::endl;
+    
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "OrdinaryBloomFilter.hpp"
+
+typedef bloom::OrdinaryBloomFilter<uint32_t> Filter;
+
+/** Checks that the fused path writes exactly what Compress then Serialize
+ *  (or SerializeEncoded) would.
+ */
+bool Check(Filter const& bf, const char *name){
+    std::stringstream expected, actual, expectedEncoded, actualEncoded;
+    bf.Compress().Serialize(expected);
+    bf.SerializeCompressed(actual);
+    if(expected.str() != actual.str()){
+        std::cout << "Error: SerializeCompressed differs from Compress and Serialize (" << name << ")." << std::endl;
+        return false;
+    }
+
+    bloom::Encoding enc = bf.Compress().SerializeEncoded(expectedEncoded);
+    if(bf.SerializeCompressed(actualEncoded, 2, true) != enc || expectedEncoded.str() != actualEncoded.str()){
+        std::cout << "Error: Encoded SerializeCompressed differs from Compress and SerializeEncoded ("
+                  << name << ")." << std::endl;
+        return false;
+    }
+
+    // Chunks arrive in order and none exceeds the block size by much.
+    std::string chunks;
+    size_t largest = 0;
+    bf.SerializeCompressedChunks([&](const unsigned char *data, size_t n){
+        chunks.append((const char *) data, n);
+        largest = std::max(largest, n);
+    }, 2, true);
+    if(chunks != expectedEncoded.str() || largest > bloom::BitArrayCodec::BlockBytes + 64){
+        std::cout << "Error: SerializeCompressedChunks produced the wrong chunks (" << name << ")." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]){
+
+    // Sparse (Rice coded), dense (raw) and partitioned filters, each larger
+    // than one block.
+    Filter sparse(4, 5 * 65538);
+    Filter dense(4, 150000);
+    Filter partitioned(4, 4 * 70000, bloom::Layout::Partitioned);
+    for(uint32_t i = 0; i < 5000; i++){
+        sparse.Insert(i);
+        partitioned.Insert(i);
+    }
+    for(uint32_t i = 0; i < 300000; i++){
+        dense.Insert(i);
+    }
+
+    if(!Check(sparse, "sparse") || !Check(dense, "dense") || !Check(partitioned, "partitioned")){
+        return 1;
+    }
+
+    // A deeper fold reads back as a smaller filter holding every element.
+    std::stringstream ss;
+    sparse.SerializeCompressed(ss, 5, true);
+    Filter small = Filter::DeserializeEncoded(ss);
+    if(small.GetnumBytes() != sparse.GetnumBytes() / 5){
+        std::cout << "Error: Folded BF has the wrong size." << std::endl;
+        return 1;
+    }
+    for(uint32_t i = 0; i < 5000; i++){
+        if(!small.Query(i)){
+            std::cout << "Error: Query on folded BF for inserted element was false." << std::endl;
+            return 1;
+        }
+    }
+
+    // The codec generates a Rice coded array twice, once to count its bits
+    // and once to code it, and writes what Encode writes for stored arrays,
+    // including around the size where coding stops paying off.
+    for(size_t numBytes = 1; numBytes < 64; numBytes++){
+        for(size_t step = 1; step < 64; step *= 3){
+            std::vector<unsigned char> bits(numBytes, 0);
+            for(size_t i = 0; i < 8 * numBytes; i += 8 * step + 5){
+                bits[i / 8] |= (unsigned char) (1u << (i % 8));
+            }
+            std::stringstream stored;
+            bloom::BitArrayCodec::Encode(bits.data(), numBytes, stored);
+            std::string produced;
+            size_t generated = 0;
+            bloom::Encoding enc = bloom::BitArrayCodec::EncodeBlocks([&](unsigned char *out, size_t offset, size_t n){
+                std::copy(bits.begin() + offset, bits.begin() + offset + n, out);
+                generated += n;
+            }, numBytes, [&](const unsigned char *data, size_t n){
+                produced.append((const char *) data, n);
+            });
+            if(produced != stored.str() || (enc != bloom::Encoding::Raw && generated != 2 * numBytes)){
+                std::cout << "Error: EncodeBlocks differs from Encode for " << numBytes << " bytes." << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    std::cout << "Tests passed." << std::endl;
+
+    return 0;
+}
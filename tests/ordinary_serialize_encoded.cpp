@@ -0,0 +1,63 @@
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include "OrdinaryBloomFilter.hpp"
+
+static bool RoundTrip(bloom::OrdinaryBloomFilter<uint32_t> const& bf, bloom::Encoding expected, size_t& wireSize){
+    std::stringstream ss;
+    bloom::Encoding enc = bf.SerializeEncoded(ss);
+    wireSize = ss.str().size();
+    
+    bloom::OrdinaryBloomFilter<uint32_t> bf_2 = bloom::OrdinaryBloomFilter<uint32_t>::DeserializeEncoded(ss);
+    
+    return enc == expected
+        && bf_2.GetNumHashes() == bf.GetNumHashes()
+        && bf_2.GetnumBytes() == bf.GetnumBytes()
+        && std::memcmp(bf_2.Data(), bf.Data(), bf.GetnumBytes()) == 0;
+}
+
+int main(int argc, char *argv[]){
+
+    const size_t numBytes = 1 << 16;
+    size_t wireSize;
+    
+    bloom::OrdinaryBloomFilter<uint32_t> empty(4, numBytes);
+    if(!RoundTrip(empty, bloom::Encoding::RiceSet, wireSize)){
+        std::cout << "Error: Empty BF did not round-trip." << std::endl;
+        return 1;
+    }
+    
+    // ~3% fill: gap coding should beat raw bits by far.
+    bloom::OrdinaryBloomFilter<uint32_t> sparse(4, numBytes + 3);
+    for(uint32_t i = 0; i < 4000; i++){
+        sparse.Insert(i);
+    }
+    if(!RoundTrip(sparse, bloom::Encoding::RiceSet, wireSize) || wireSize > numBytes / 3){
+        std::cout << "Error: Sparse BF did not round-trip compactly (" << wireSize << " bytes)." << std::endl;
+        return 1;
+    }
+    
+    // ~50% fill: stays raw.
+    bloom::OrdinaryBloomFilter<uint32_t> half(4, numBytes);
+    for(uint32_t i = 0; i < 90000; i++){
+        half.Insert(i);
+    }
+    if(!RoundTrip(half, bloom::Encoding::Raw, wireSize)){
+        std::cout << "Error: Half-full BF did not round-trip raw." << std::endl;
+        return 1;
+    }
+    
+    // ~97% fill: code the clear bits.
+    bloom::OrdinaryBloomFilter<uint32_t> dense(4, numBytes);
+    for(uint32_t i = 0; i < 460000; i++){
+        dense.Insert(i);
+    }
+    if(!RoundTrip(dense, bloom::Encoding::RiceClear, wireSize) || wireSize > numBytes / 3){
+        std::cout << "Error: Dense BF did not round-trip compactly (" << wireSize << " bytes)." << std::endl;
+        return 1;
+    }
+    
+    std::cout << "Tests passed." << std::endl;
+    
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <iostream>
+#include "OrdinaryBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    bloom::OrdinaryBloomFilter<uint32_t> bf(4, 1001);
+    for(uint32_t i = 0; i < 500; i++){
+        bf.Insert(i);
+    }
+
+    bloom::CountingBloomFilter<uint32_t> cbf = bf.ToCountingBloomFilter();
+    if(cbf.GetNumBits() != bf.GetNumBits() || cbf.GetNumHashes() != bf.GetNumHashes()){
+        std::cout << "Error: Converted BF disagrees on shape." << std::endl;
+        return 1;
+    }
+    for(uint32_t i = 0; i < 5000; i++){
+        if(cbf.Query(i) != bf.Query(i)){
+            std::cout << "Error: Counting BF disagrees with ordinary BF." << std::endl;
+            return 1;
+        }
+    }
+
+    // Round trip through a reused destination gives the same bits back.
+    bloom::OrdinaryBloomFilter<uint32_t> out(1, 16);
+    cbf.ToOrdinary(out);
+    if(out.GetnumBytes() != bf.GetnumBytes() || !std::equal(bf.Data(), bf.Data() + bf.GetnumBytes(), out.Data())){
+        std::cout << "Error: Round trip through counting BF changed the bits." << std::endl;
+        return 1;
+    }
+
+    // Converting again into the same destinations does not reallocate.
+    const unsigned char *storage = out.Data();
+    cbf.Insert(100000);
+    cbf.ToOrdinary(out);
+    if(out.Data() != storage || !out.Query(100000)){
+        std::cout << "Error: Reused destination was reallocated or is stale." << std::endl;
+        return 1;
+    }
+
+    bloom::PairedBloomFilter<uint32_t> pbf(1, 16);
+    bf.ToPaired(pbf);
+    for(uint32_t i = 0; i < 5000; i++){
+        if(pbf.Query(i) != bf.Query(i)){
+            std::cout << "Error: Paired BF disagrees with ordinary BF." << std::endl;
+            return 1;
+        }
+    }
+    pbf.Delete(7);
+    bf.ToPaired(pbf);
+    if(!pbf.Query(7)){
+        std::cout << "Error: Reused paired destination kept its negative set." << std::endl;
+        return 1;
+    }
+
+    // Counters of any value pack to a set bit.
+    bloom::CountingBloomFilter<uint32_t> odd(3, 40);
+    for(uint32_t i = 0; i < 20; i++){
+        odd.Insert(i % 5);
+    }
+    bloom::OrdinaryBloomFilter<uint32_t> packed = odd.ToOrdinaryBloomFilter();
+    for(uint32_t i = 0; i < 5; i++){
+        if(!packed.Query(i)){
+            std::cout << "Error: Query for packed element was false." << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Tests passed." << std::endl;
+    return 0;
+}
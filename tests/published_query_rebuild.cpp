@@ -0,0 +1,110 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "PublishedBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    bloom::PublishedBloomFilter<uint32_t> pbf(4, 1 << 14);
+
+    // Keys below 100 are in every version; key 100000 + v marks version v.
+    bloom::OrdinaryBloomFilter<uint32_t> &first = pbf.BeginUpdate();
+    for(uint32_t i = 0; i < 100; i++){
+        first.Insert(i);
+    }
+    pbf.Publish();
+
+    std::atomic<bool> done(false);
+    std::atomic<size_t> errors(0);
+    std::atomic<size_t> queries(0);
+    std::vector<std::thread> readers;
+    for(int t = 0; t < 4; t++){
+        readers.emplace_back([&](){
+            while(!done.load()){
+                for(uint32_t i = 0; i < 100; i++){
+                    if(!pbf.Query(i)){
+                        errors++;
+                    }
+                }
+                // A long read, giving the writer a chance to rebuild the
+                // buffer under it if reclamation were broken.
+                errors += pbf.Read([](bloom::OrdinaryBloomFilter<uint32_t> const& bf){
+                    size_t missing = 0;
+                    std::this_thread::yield();
+                    for(uint32_t i = 0; i < 100; i++){
+                        missing += !bf.Query(i);
+                    }
+                    return missing;
+                });
+                queries += 200;
+            }
+        });
+    }
+
+    const uint32_t numVersions = 200;
+    for(uint32_t v = 1; v <= numVersions; v++){
+        bloom::OrdinaryBloomFilter<uint32_t> &next = pbf.BeginUpdate();
+        next.Clear();
+        // Rebuilds take a while; let readers run meanwhile.
+        std::this_thread::yield();
+        for(uint32_t i = 0; i < 100; i++){
+            next.Insert(i);
+        }
+        next.Insert(100000 + v);
+        pbf.Publish();
+
+        if(!pbf.Query(100000 + v)){
+            std::cout << "Error: Published version is not visible." << std::endl;
+            return 1;
+        }
+    }
+
+    while(queries < 1000){
+        std::this_thread::yield();
+    }
+    done = true;
+    for(size_t t = 0; t < readers.size(); t++){
+        readers[t].join();
+    }
+
+    if(errors != 0){
+        std::cout << "Error: Readers saw a buffer being rebuilt: " << errors << " false negatives." << std::endl;
+        return 1;
+    }
+    std::stringstream ss;
+    pbf.Serialize(ss);
+    bloom::OrdinaryBloomFilter<uint32_t> copy = bloom::OrdinaryBloomFilter<uint32_t>::Deserialize(ss);
+    if(!copy.Query(100000 + numVersions)){
+        std::cout << "Error: Serialized filter is not the published version." << std::endl;
+        return 1;
+    }
+
+    // A nested Read must not end the protection of the enclosing one: the
+    // buffer read outside is retired by the next Publish, and BeginUpdate
+    // may only hand it back once the outer Read has returned.
+    std::atomic<bool> reused(false);
+    std::thread writer;
+    bool found = pbf.Read([&](bloom::OrdinaryBloomFilter<uint32_t> const& outer){
+        pbf.Read([](bloom::OrdinaryBloomFilter<uint32_t> const& inner){ return inner.Query(0); });
+        writer = std::thread([&](){
+            pbf.BeginUpdate().Insert(0);
+            pbf.Publish();
+            pbf.BeginUpdate();
+            reused = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return outer.Query(0);
+    });
+    bool early = reused;
+    writer.join();
+    if(early || !found){
+        std::cout << "Error: A nested Read released the enclosing one." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ShardedBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    const uint32_t numKeys = 40000;
+    const unsigned numThreads = 4;
+    
+    bloom::ShardedBloomFilter<uint32_t> bf(4, 1 << 16, 8);
+    
+    std::vector<std::thread> writers;
+    for(unsigned t = 0; t < numThreads; t++){
+        writers.emplace_back([&bf, t](){
+            for(uint32_t i = t; i < numKeys; i += numThreads){
+                bf.Insert(i);
+            }
+        });
+    }
+    for(size_t t = 0; t < writers.size(); t++){
+        writers[t].join();
+    }
+    
+    for(uint32_t i = 0; i < numKeys; i++){
+        if(!bf.Query(i)){
+            std::cout << "Error: Query for concurrently inserted element was false." << std::endl;
+            return 1;
+        }
+    }
+    
+    std::vector<uint32_t> batch;
+    for(uint32_t i = numKeys; i < 2 * numKeys; i++){
+        batch.push_back(i);
+    }
+    bloom::ShardedBloomFilter<uint32_t> bf2(4, 1 << 16, 8);
+    bf2.InsertBatch(batch.data(), batch.size());
+    
+    for(uint32_t i = 0; i < batch.size(); i++){
+        if(!bf2.Query(batch[i])){
+            std::cout << "Error: Query for batch inserted element was false." << std::endl;
+            return 1;
+        }
+    }
+    
+    bf.Union(bf2);
+    
+    std::stringstream ss;
+    bf.Serialize(ss);
+    bloom::ShardedBloomFilter<uint32_t> bf3 = bloom::ShardedBloomFilter<uint32_t>::Deserialize(ss);
+    
+    if(bf3.GetNumShards() != bf.GetNumShards() || bf3.GetnumBytes() != bf.GetnumBytes()){
+        std::cout << "Error: Deserialized BF disagrees on shape." << std::endl;
+        return 1;
+    }
+    
+    for(uint32_t i = 0; i < 4 * numKeys; i++){
+        if(bf3.Query(i) != bf.Query(i) || (i < 2 * numKeys && !bf3.Query(i))){
+            std::cout << "Error: Deserialized union disagrees with original." << std::endl;
+            return 1;
+        }
+    }
+    
+    // Zero shards would route every object with a division by zero.
+    bool thrown = false;
+    try {
+        bloom::ShardedBloomFilter<uint32_t> none(4, 1024, 0);
+    } catch(std::invalid_argument const&) {
+        thrown = true;
+    }
+    std::string header = ss.str().substr(0, sizeof(uint8_t));
+    header.append(sizeof(size_t), '\0');
+    // A header cut short is rejected the same way.
+    const std::string headers[] = { header, ss.str().substr(0, 3) };
+    for(int i = 0; i < 2; i++){
+        std::stringstream noShards(headers[i]);
+        try {
+            bloom::ShardedBloomFilter<uint32_t>::Deserialize(noShards);
+            thrown = false;
+        } catch(std::invalid_argument const&) {
+        }
+    }
+    if(!thrown){
+        std::cout << "Error: ShardedBloomFilter without shards was accepted." << std::endl;
+        return 1;
+    }
+    
+    // Shards are combined pairwise, so their number and size must match.
+    bloom::ShardedBloomFilter<uint32_t> fewerShards(4, 1 << 16, 4), smallerShards(4, 1 << 15, 8);
+    bloom::ShardedBloomFilter<uint32_t> *mismatched[] = { &fewerShards, &smallerShards };
+    for(int i = 0; i < 2; i++){
+        try {
+            bf.Union(*mismatched[i]);
+            std::cout << "Error: Union accepted a BF of another shape." << std::endl;
+            return 1;
+        } catch(std::invalid_argument const&) {
+        }
+    }
+    
+    std::cout << "Tests passed." << std::endl;
+    
+    return 0;
+}
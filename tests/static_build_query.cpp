@@ -0,0 +1,100 @@
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "StaticFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    std::vector<uint32_t> keys;
+    for(uint32_t i = 0; i < 100000; i++){
+        keys.push_back(i * 7);
+    }
+    // Duplicates are ignored.
+    keys.push_back(0);
+    keys.push_back(7);
+
+    bloom::StaticFilter<uint32_t> sf = bloom::StaticFilter<uint32_t>::Build(keys.data(), keys.size(), 4);
+
+    for(size_t i = 0; i < keys.size(); i++){
+        if(!sf.Query(keys[i])){
+            std::cout << "Error: Query for built element was false." << std::endl;
+            return 1;
+        }
+    }
+
+    size_t falsePositives = 0;
+    for(uint32_t i = 0; i < 700000; i++){
+        if(i % 7 != 0){
+            falsePositives += sf.Query(i);
+        }
+    }
+    // Expected rate is 1/256 of 600000 queries, about 2344.
+    if(falsePositives > 3000){
+        std::cout << "Error: Too many false positives: " << falsePositives << std::endl;
+        return 1;
+    }
+
+    if(sf.GetnumBytes() > 125000){
+        std::cout << "Error: Filter is larger than 10 bits per element." << std::endl;
+        return 1;
+    }
+
+    std::stringstream ss;
+    sf.Serialize(ss);
+    bloom::StaticFilter<uint32_t> sf_2 = bloom::StaticFilter<uint32_t>::Deserialize(ss);
+
+    for(uint32_t i = 0; i < 700000; i++){
+        if(sf_2.Query(i) != sf.Query(i)){
+            std::cout << "Error: Deserialized filter disagrees with original." << std::endl;
+            return 1;
+        }
+    }
+
+    // 16-bit fingerprints, single-threaded build.
+    bloom::StaticFilter<uint32_t, uint16_t> sf16 = bloom::StaticFilter<uint32_t, uint16_t>::Build(keys.data(), keys.size());
+    falsePositives = 0;
+    for(uint32_t i = 0; i < 700000; i++){
+        if(i % 7 == 0 && !sf16.Query(i)){
+            std::cout << "Error: Query for built element was false." << std::endl;
+            return 1;
+        }
+        if(i % 7 != 0){
+            falsePositives += sf16.Query(i);
+        }
+    }
+    if(falsePositives > 50){
+        std::cout << "Error: Too many false positives with 16-bit fingerprints." << std::endl;
+        return 1;
+    }
+
+    bloom::StaticFilter<uint32_t> empty = bloom::StaticFilter<uint32_t>::Build(keys.data(), 0);
+    (void) empty.Query(1);
+
+    // Filters of another fingerprint width or cut short are rejected.
+    std::stringstream wide;
+    sf16.Serialize(wide);
+    std::string full = wide.str();
+    bool rejected = true;
+    const size_t cuts[] = { 5, full.size() - 1 };
+    for(int i = 0; i < 3; i++){
+        std::stringstream is(i == 0 ? full : full.substr(0, cuts[i - 1]));
+        try {
+            if(i == 0){
+                bloom::StaticFilter<uint32_t>::Deserialize(is);
+            } else {
+                bloom::StaticFilter<uint32_t, uint16_t>::Deserialize(is);
+            }
+            rejected = false;
+        } catch(std::invalid_argument const&) {
+        }
+    }
+    if(!rejected){
+        std::cout << "Error: Invalid serialized filter was accepted." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Tests passed." << std::endl;
+    return 0;
+}
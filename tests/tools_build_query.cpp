@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/** Drives tools/bloom_build and tools/bloom_query end to end. Run from the
+ *  repository root after make tools, as make run_tests does.
+ */
+
+std::string dir;
+
+/** Runs a shell command and returns its exit status.
+ */
+int Run(std::string const& command) {
+    int status = std::system((command + " 2>/dev/null").c_str());
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+std::string ReadFile(std::string const& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+void WriteKeys(std::string const& path, size_t begin, size_t end, size_t repeat) {
+    std::ofstream out(path);
+    for(size_t r = 0; r < repeat; r++){
+        for(size_t i = begin; i < end; i++){
+            out << "key-" << i << "\n";
+        }
+    }
+}
+
+/** Builds a filter of the given type and returns the summary line of
+ *  querying it with a key file.
+ */
+std::string BuildAndQuery(std::string const& type, std::string const& options, std::string const& keys,
+                          std::string const& queries) {
+    std::string filter = dir + "/" + type + ".bf";
+    std::string result = dir + "/result";
+    if(Run("tools/bloom_build --type " + type + " " + options + " " + keys + " " + filter) != 0
+       || Run("tools/bloom_query --summary --type " + type + " " + filter + " " + queries + " > " + result) != 0){
+        return "failed to run";
+    }
+    return ReadFile(result);
+}
+
+int main(int argc, char *argv[]){
+
+    char pattern[] = "/tmp/bloom_tools_XXXXXX";
+    if(!mkdtemp(pattern)){
+        std::cout << "Error: Cannot create a temporary directory." << std::endl;
+        return 1;
+    }
+    dir = pattern;
+    std::string keys = dir + "/keys", others = dir + "/others", repeated = dir + "/repeated";
+    WriteKeys(keys, 0, 20000, 1);
+    WriteKeys(others, 20000, 40000, 1);
+    WriteKeys(repeated, 0, 1000, 3);
+
+    const char *types[] = { "ordinary", "counting", "paired", "static" };
+    for(size_t t = 0; t < 4; t++){
+        std::string found = BuildAndQuery(types[t], "--hashes 5 --size 262144 --threads 4", keys, keys);
+        if(found != "20000 of 20000 keys found\n"){
+            std::cout << "Error: " << types[t] << " filter lost keys: " << found << std::endl;
+            return 1;
+        }
+        unsigned long falsePositives = 20000;
+        sscanf(BuildAndQuery(types[t], "--hashes 5 --size 262144 --threads 4", keys, others).c_str(),
+               "%lu", &falsePositives);
+        if(falsePositives > 400){
+            std::cout << "Error: Too many false positives for " << types[t] << ": " << falsePositives << std::endl;
+            return 1;
+        }
+    }
+
+    // Counting filters built by several threads share one counter array;
+    // the result must not depend on the number of threads.
+    std::string one = dir + "/one.bf", four = dir + "/four.bf";
+    if(Run("tools/bloom_build --type counting --size 4099 --threads 1 " + repeated + " " + one) != 0
+       || Run("tools/bloom_build --type counting --size 4099 --threads 4 " + repeated + " " + four) != 0
+       || ReadFile(one).empty() || ReadFile(one) != ReadFile(four)){
+        std::cout << "Error: Threaded counting build differs from the sequential one." << std::endl;
+        return 1;
+    }
+    std::string counts = dir + "/counts";
+    if(Run("tools/bloom_query --type counting " + four + " " + repeated + " > " + counts) != 0){
+        std::cout << "Error: Cannot query the counting filter." << std::endl;
+        return 1;
+    }
+    std::istringstream lines(ReadFile(counts));
+    unsigned count;
+    size_t n = 0;
+    while(lines >> count){
+        n++;
+        if(count < 3){
+            std::cout << "Error: Estimated count below the number of inserts." << std::endl;
+            return 1;
+        }
+    }
+    if(n != 3000){
+        std::cout << "Error: Expected one count per key, got " << n << std::endl;
+        return 1;
+    }
+
+    // Raw uint32 keys are handed out in batches across uneven chunks.
+    std::string u32 = dir + "/u32";
+    {
+        std::ofstream out(u32, std::ios::binary);
+        for(uint32_t i = 0; i < 5003; i++){
+            out.write((const char *) &i, sizeof(uint32_t));
+        }
+    }
+    std::string u32Found = BuildAndQuery("ordinary", "--format u32 --threads 3", u32, "--format u32 " + u32);
+    if(u32Found != "5003 of 5003 keys found\n"){
+        std::cout << "Error: uint32 key file lost keys: " << u32Found << std::endl;
+        return 1;
+    }
+
+    // Shapes that cannot be built are rejected with a usage error.
+    const char *invalid[] = { "--hashes 0", "--hashes 256", "--hashes -1", "--size 0", "--size x",
+                              "--threads 0", "--threads 1025" };
+    for(size_t i = 0; i < 7; i++){
+        if(Run("tools/bloom_build " + std::string(invalid[i]) + " " + keys + " " + dir + "/invalid.bf") != 2){
+            std::cout << "Error: bloom_build accepted " << invalid[i] << std::endl;
+            return 1;
+        }
+    }
+
+    Run("rm -rf " + dir);
+
+    std::cout << "Tests passed." << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <iostream>
+#include <sstream>
+#include "TwoLevelBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    bloom::TwoLevelBloomFilter<uint32_t> bf(6, 1 << 20, 1 << 15);
+    for(uint32_t i = 0; i < 10000; i++){
+        bf.Insert(i);
+    }
+
+    size_t summaryRejects = 0;
+    for(uint32_t i = 0; i < 110000; i++){
+        bool present = bf.Query(i);
+        if(present != bf.GetMain().Query(i)){
+            std::cout << "Error: Two-level filter disagrees with its main filter." << std::endl;
+            return 1;
+        }
+        if(i < 10000 && !present){
+            std::cout << "Error: Query for inserted element was false." << std::endl;
+            return 1;
+        }
+        summaryRejects += i >= 10000 && !bf.GetSummary().Query(i);
+    }
+    // 10000 objects in a 2^18 bit summary: about 96% of negatives rejected.
+    if(summaryRejects < 90000){
+        std::cout << "Error: Summary rejected too few negatives: " << summaryRejects << std::endl;
+        return 1;
+    }
+
+    bloom::TwoLevelBloomFilter<uint32_t> other(6, 1 << 20, 1 << 15);
+    other.Insert(500000);
+    bf.Union(other);
+    if(!bf.Query(500000) || !bf.Query(1)){
+        std::cout << "Error: Union lost an element." << std::endl;
+        return 1;
+    }
+
+    std::stringstream ss;
+    bf.Serialize(ss);
+    bloom::TwoLevelBloomFilter<uint32_t> bf_2 = bloom::TwoLevelBloomFilter<uint32_t>::Deserialize(ss);
+    for(uint32_t i = 0; i < 20000; i++){
+        if(bf_2.Query(i) != bf.Query(i)){
+            std::cout << "Error: Deserialized filter disagrees with original." << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Tests passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "SlidingWindowBloomFilter.hpp"
+
+int main(int argc, char *argv[]){
+
+    // 4 generations of 100 inserts: anything in the last 300 inserts is kept.
+    bloom::SlidingWindowBloomFilter<uint32_t> bf(4, 4096, 4, 100);
+    
+    for(uint32_t i = 0; i < 1000; i++){
+        bf.Insert(i);
+        
+        for(uint32_t j = (i < 300 ? 0 : i - 300); j <= i; j++){
+            if(!bf.Query(j)){
+                std::cout << "Error: Query for element inside the window was false." << std::endl;
+                return 1;
+            }
+        }
+    }
+    
+    size_t expired = 0;
+    for(uint32_t i = 0; i < 600; i++){
+        expired += !bf.Query(i);
+    }
+    if(expired < 590){
+        std::cout << "Error: Elements outside the window were not expired." << std::endl;
+        return 1;
+    }
+    
+    std::stringstream ss;
+    bf.Serialize(ss);
+    bloom::SlidingWindowBloomFilter<uint32_t> bf_2 = bloom::SlidingWindowBloomFilter<uint32_t>::Deserialize(ss);
+    
+    for(uint32_t i = 0; i < 1000; i++){
+        if(bf_2.Query(i) != bf.Query(i)){
+            std::cout << "Error: Deserialized window disagrees with original." << std::endl;
+            return 1;
+        }
+    }
+    
+    // Manual rotation, e.g. once per step.
+    bloom::SlidingWindowBloomFilter<uint32_t> steps(4, 4096, 2);
+    steps.Insert(1);
+    steps.Rotate();
+    steps.Insert(2);
+    if(!steps.Query(1) || !steps.Query(2)){
+        std::cout << "Error: Query for element of previous step was false." << std::endl;
+        return 1;
+    }
+    steps.Rotate();
+    if(steps.Query(1) || !steps.Query(2)){
+        std::cout << "Error: Manual rotation expired the wrong generation." << std::endl;
+        return 1;
+    }
+    
+    // A window needs at least one generation, and its cursor must point
+    // into the ring.
+    bool thrown = false;
+    try {
+        bloom::SlidingWindowBloomFilter<uint32_t> none(4, 4096, 0);
+    } catch(std::invalid_argument const&) {
+        thrown = true;
+    }
+    std::stringstream serialized;
+    steps.Serialize(serialized);
+    // numGenerations and the cursor follow the number of hashes.
+    const size_t start = sizeof(uint8_t);
+    for(int field = 0; field < 2 && thrown; field++){
+        std::string corrupt = serialized.str();
+        size_t value = field == 0 ? 0 : 2;
+        corrupt.replace(start + field * sizeof(size_t), sizeof(size_t), (const char *) &value, sizeof(size_t));
+        std::stringstream is(corrupt);
+        try {
+            bloom::SlidingWindowBloomFilter<uint32_t>::Deserialize(is);
+            thrown = false;
+        } catch(std::invalid_argument const&) {
+        }
+    }
+    if(!thrown){
+        std::cout << "Error: Window without a valid ring was accepted." << std::endl;
+        return 1;
+    }
+    
+    std::cout << "Tests passed." << std::endl;
+    
+    return 0;
+}
@@ -0,0 +1,268 @@
+#ifndef KeyFile_hpp
+#define KeyFile_hpp
+
+/** Shared helpers of the command line tools: memory-mapped key files split
+ *  into chunks processed in parallel, a bounded batch of keys at a time,
+ *  and the key types they produce.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AbstractBloomFilter.hpp"
+
+namespace bloom {
+
+/** A key of a text key file: one line, pointing into the mapped file.
+ */
+struct KeyRef {
+    const char *data;
+    size_t length;
+};
+
+} // namespace bloom
+
+/** Lines hash like std::string keys, so filters built by the tools answer
+ *  queries from library code holding the same keys as strings.
+ */
+namespace std {
+    template<>
+    struct hash<bloom::HashParams<bloom::KeyRef>> {
+        size_t operator()(bloom::HashParams<bloom::KeyRef> const &s) const {
+            return bloom::HashBytes(s.a.data, s.a.length, s.b);
+        }
+    };
+}
+
+namespace bloom {
+
+/** Read-only memory mapping of a whole file.
+ */
+class MappedFile {
+
+public:
+
+    explicit
+    MappedFile(const char *path)
+    : m_data(nullptr), m_size(0)
+    {
+        int fd = open(path, O_RDONLY);
+        if(fd < 0){
+            throw std::runtime_error(std::string("cannot open ") + path);
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0){
+            close(fd);
+            throw std::runtime_error(std::string("cannot stat ") + path);
+        }
+        m_size = st.st_size;
+        if(m_size > 0){
+            // Pages are faulted in as the chunks are read rather than all
+            // up front, so work starts at once on files larger than memory.
+            void *p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p == MAP_FAILED){
+                close(fd);
+                throw std::runtime_error(std::string("cannot map ") + path);
+            }
+            madvise(p, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char *>(p);
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if(m_data != nullptr){
+            munmap(const_cast<char *>(m_data), m_size);
+        }
+    }
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    const char* Data() const {
+        return m_data;
+    }
+
+    size_t Size() const {
+        return m_size;
+    }
+
+private:
+
+    const char *m_data;
+    size_t m_size;
+
+}; // class MappedFile
+
+/** Splits a newline separated buffer into about numChunks ranges that start
+ *  at line boundaries.
+ *
+ *  @return numChunks + 1 offsets; chunk c is [offsets[c], offsets[c + 1])
+ */
+inline std::vector<size_t> SplitLines(const char *data, size_t size, size_t numChunks) {
+    std::vector<size_t> offsets(numChunks + 1, size);
+    offsets[0] = 0;
+    for(size_t c = 1; c < numChunks; c++){
+        size_t start = std::max(offsets[c - 1], size / numChunks * c);
+        const void *nl = start < size ? memchr(data + start, '\n', size - start) : nullptr;
+        offsets[c] = nl ? static_cast<const char *>(nl) - data + 1 : size;
+    }
+    return offsets;
+}
+
+/** Chunk c of n fixed-width keys split into numChunks ranges.
+ */
+inline void ChunkRange(size_t n, size_t numChunks, size_t c, size_t &begin, size_t &end) {
+    begin = n / numChunks * c + std::min(c, n % numChunks);
+    end = begin + n / numChunks + (c < n % numChunks ? 1 : 0);
+}
+
+/** Number of keys handed to the tools' workers at a time, bounding the
+ *  memory used per thread for key references, hashes and results.
+ */
+const size_t KeyBatchSize = 1024;
+
+/** Largest accepted --threads value.
+ */
+const size_t MaxThreads = 1024;
+
+/** Appends the non-empty lines of [begin, end) to keys, without copying,
+ *  until keys holds maxKeys entries.
+ *
+ *  @return Start of the first line not parsed
+ */
+inline const char *ParseLines(const char *begin, const char *end, std::vector<KeyRef> &keys, size_t maxKeys) {
+    while(begin < end && keys.size() < maxKeys){
+        const char *nl = static_cast<const char *>(memchr(begin, '\n', end - begin));
+        const char *stop = nl ? nl : end;
+        size_t length = stop - begin;
+        if(length > 0 && begin[length - 1] == '\r'){
+            length--;
+        }
+        if(length > 0){
+            keys.push_back(KeyRef{begin, length});
+        }
+        begin = stop + 1;
+    }
+    return begin;
+}
+
+/** A text key file, one key per line, split into chunks at line
+ *  boundaries. Each chunk is parsed lazily in batches of KeyBatchSize
+ *  lines, so no index of the whole file is ever built.
+ */
+class TextKeys {
+
+public:
+
+    typedef KeyRef Key;
+
+    TextKeys(MappedFile const& file, size_t numChunks)
+    : m_data(file.Data()), m_offsets(SplitLines(file.Data(), file.Size(), numChunks))
+    {}
+
+    size_t NumChunks() const {
+        return m_offsets.size() - 1;
+    }
+
+    /** Calls fn(keys, n) for consecutive batches of the keys of chunk c.
+     */
+    template <typename F>
+    void ForEachBatch(size_t c, F fn) const {
+        std::vector<KeyRef> keys;
+        keys.reserve(KeyBatchSize);
+        const char *begin = m_data + m_offsets[c], *end = m_data + m_offsets[c + 1];
+        while(begin < end){
+            keys.clear();
+            begin = ParseLines(begin, end, keys, KeyBatchSize);
+            if(!keys.empty()){
+                fn(keys.data(), keys.size());
+            }
+        }
+    }
+
+private:
+
+    const char *m_data;
+    std::vector<size_t> m_offsets;
+
+}; // class TextKeys
+
+/** A file of raw little-endian uint32 keys, split into chunks of about
+ *  equal size and handed out in batches of KeyBatchSize keys.
+ */
+class U32Keys {
+
+public:
+
+    typedef uint32_t Key;
+
+    U32Keys(MappedFile const& file, size_t numChunks)
+    : m_keys(reinterpret_cast<const uint32_t *>(file.Data())), m_size(file.Size() / sizeof(uint32_t)),
+      m_numChunks(numChunks)
+    {}
+
+    size_t NumChunks() const {
+        return m_numChunks;
+    }
+
+    template <typename F>
+    void ForEachBatch(size_t c, F fn) const {
+        size_t begin, end;
+        ChunkRange(m_size, m_numChunks, c, begin, end);
+        for(size_t b = begin; b < end; b += KeyBatchSize){
+            fn(m_keys + b, std::min(KeyBatchSize, end - b));
+        }
+    }
+
+private:
+
+    const uint32_t *m_keys;
+    size_t m_size;
+    size_t m_numChunks;
+
+}; // class U32Keys
+
+/** Runs fn(c) for each chunk c in [0, numChunks), one thread per chunk.
+ */
+template <typename F>
+void ForEachChunk(size_t numChunks, F fn) {
+    std::vector<std::thread> workers;
+    for(size_t c = 0; c < numChunks; c++){
+        workers.emplace_back(fn, c);
+    }
+    for(size_t c = 0; c < workers.size(); c++){
+        workers[c].join();
+    }
+}
+
+/** Returns the value of a numeric command line option, or exits if it is
+ *  not a number in [min, max].
+ */
+inline unsigned long long ParseNumber(const char *option, const char *value,
+                                      unsigned long long min = 0, unsigned long long max = ULLONG_MAX) {
+    char *end;
+    unsigned long long v = strtoull(value, &end, 0);
+    if(*value == '\0' || *value == '-' || *end != '\0' || v < min || v > max){
+        fprintf(stderr, "invalid value for %s: %s\n", option, value);
+        exit(2);
+    }
+    return v;
+}
+
+} // namespace bloom
+
+#endif
@@ -0,0 +1,381 @@
+/** Simulates an allreduce of per-worker ordinary Bloom filters in one
+ *  process: every worker is a thread and the network is a set of
+ *  shared-memory channels, so filter sizing, encoding and reduction
+ *  topology can be compared without a cluster.
+ *
+ *  Usage: bloom_allreduce_sim [options]
+ *
+ *    --workers W              Number of workers (8)
+ *    --size N                 Filter size in bytes (1048576)
+ *    --hashes K               Hashes per key (4)
+ *    --keys N                 Random keys inserted per worker (100000)
+ *    --topology ring|tree     Reduction topology (ring)
+ *    --encoding raw|rice      Wire encoding of the bit arrays (rice)
+ *    --gbps G                 Simulated link bandwidth in Gbit/s; 0 for
+ *                             none (0)
+ *    --seed S                 Seed of the key generator (1)
+ *
+ *  ring: the bit array is cut into W segments; W - 1 reduce-scatter steps
+ *  leave each worker with one segment ORed over all workers, and W - 1
+ *  allgather steps circulate the reduced segments. Each step sends one
+ *  encoded segment to the next worker.
+ *
+ *  tree: whole filters are reduced up a binomial tree to worker 0 with
+ *  SerializeEncoded (or Serialize) and Union, and the result is broadcast
+ *  back down the same tree.
+ *
+ *  Each stage (build, encode, transfer, decode, union) is timed per worker.
+ *  The report gives the slowest and the mean worker, the bytes sent, and
+ *  checks that every worker ends with the union of all filters.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "KeyFile.hpp"
+#include "OrdinaryBloomFilter.hpp"
+
+namespace {
+
+typedef bloom::OrdinaryBloomFilter<uint64_t> Filter;
+
+struct Options {
+    size_t numWorkers = 8;
+    size_t size = 1 << 20;
+    uint8_t numHashes = 4;
+    size_t numKeys = 100000;
+    std::string topology = "ring";
+    std::string encoding = "rice";
+    double gbps = 0;
+    unsigned long long seed = 1;
+};
+
+enum Stage { Build, Encode, Transfer, Decode, Merge, NumStages };
+
+const char *StageNames[NumStages] = { "build", "encode", "transfer", "decode", "union" };
+
+/** Per-worker measurements.
+ */
+struct Stats {
+    double seconds[NumStages] = {};
+    uint64_t bytesSent = 0;
+    uint64_t messages = 0;
+};
+
+class Timer {
+
+public:
+
+    Timer(Stats &stats, Stage stage)
+    : m_stats(stats), m_stage(stage), m_start(std::chrono::steady_clock::now())
+    {}
+
+    ~Timer() {
+        std::chrono::duration<double> d = std::chrono::steady_clock::now() - m_start;
+        m_stats.seconds[m_stage] += d.count();
+    }
+
+private:
+
+    Stats &m_stats;
+    Stage m_stage;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/** Inbox of one worker: messages tagged with their sender.
+ */
+class Channel {
+
+public:
+
+    void Send(size_t from, std::string message) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::make_pair(from, std::move(message)));
+        m_ready.notify_all();
+    }
+
+    /** Waits for the oldest message from the given sender.
+     */
+    std::string Receive(size_t from) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for(;;){
+            for(auto it = m_queue.begin(); it != m_queue.end(); ++it){
+                if(it->first == from){
+                    std::string message = std::move(it->second);
+                    m_queue.erase(it);
+                    return message;
+                }
+            }
+            m_ready.wait(lock);
+        }
+    }
+
+private:
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::deque<std::pair<size_t, std::string>> m_queue;
+};
+
+/** The simulated network: one inbox per worker.
+ */
+class Network {
+
+public:
+
+    Network(size_t numWorkers, double gbps)
+    : m_inboxes(numWorkers), m_gbps(gbps)
+    {}
+
+    void Send(size_t from, size_t to, std::string message, Stats &stats) {
+        Timer t(stats, Transfer);
+        stats.bytesSent += message.size();
+        stats.messages++;
+        if(m_gbps > 0){
+            std::this_thread::sleep_for(std::chrono::duration<double>(8.0 * message.size() / (m_gbps * 1e9)));
+        }
+        m_inboxes[to].Send(from, std::move(message));
+    }
+
+    std::string Receive(size_t self, size_t from, Stats &stats) {
+        Timer t(stats, Transfer);
+        return m_inboxes[self].Receive(from);
+    }
+
+private:
+
+    std::vector<Channel> m_inboxes;
+    double m_gbps;
+};
+
+/** Encodes bytes [begin, end) of a bit array for the wire.
+ */
+std::string EncodeSegment(Options const& opt, const unsigned char *bits, size_t begin, size_t end) {
+    std::ostringstream os;
+    if(opt.encoding == "rice"){
+        bloom::BitArrayCodec::Encode(bits + begin, end - begin, os);
+    } else {
+        os.write((const char *) bits + begin, end - begin);
+    }
+    return os.str();
+}
+
+void DecodeSegment(Options const& opt, std::string const& message, unsigned char *out, size_t length) {
+    if(opt.encoding == "rice"){
+        std::istringstream is(message);
+        bloom::BitArrayCodec::Decode(is, out, length);
+    } else {
+        std::copy(message.begin(), message.end(), out);
+    }
+}
+
+void RingAllreduce(Options const& opt, size_t self, Filter &bf, Network &net, Stats &stats) {
+    const size_t w = opt.numWorkers;
+    const size_t next = (self + 1) % w, prev = (self + w - 1) % w;
+    unsigned char *bits = bf.Get_bloom().data();
+    std::vector<unsigned char> incoming;
+
+    // Step s of reduce-scatter sends segment self - s and ORs in segment
+    // self - s - 1, leaving segment self + 1 reduced; step s of allgather
+    // sends segment self + 1 - s and stores segment self - s.
+    for(size_t step = 0; step < 2 * (w - 1); step++){
+        bool reducing = step < w - 1;
+        size_t s = reducing ? step : step - (w - 1);
+        size_t sendSeg = (self + w - s + (reducing ? 0 : 1)) % w;
+        size_t recvSeg = (sendSeg + w - 1) % w;
+        size_t begin, end;
+        std::string message;
+        {
+            Timer t(stats, Encode);
+            bloom::ChunkRange(opt.size, w, sendSeg, begin, end);
+            message = EncodeSegment(opt, bits, begin, end);
+        }
+        net.Send(self, next, std::move(message), stats);
+        message = net.Receive(self, prev, stats);
+
+        bloom::ChunkRange(opt.size, w, recvSeg, begin, end);
+        incoming.resize(end - begin);
+        {
+            Timer t(stats, Decode);
+            DecodeSegment(opt, message, incoming.data(), end - begin);
+        }
+        Timer t(stats, Merge);
+        if(reducing){
+            bloom::bits::Combine(bits + begin, incoming.data(), end - begin, bloom::bits::OrOp());
+        } else {
+            std::copy(incoming.begin(), incoming.end(), bits + begin);
+        }
+    }
+}
+
+std::string EncodeFilter(Options const& opt, Filter const& bf, Stats &stats) {
+    Timer t(stats, Encode);
+    std::ostringstream os;
+    if(opt.encoding == "rice"){
+        bf.SerializeEncoded(os);
+    } else {
+        bf.Serialize(os);
+    }
+    return os.str();
+}
+
+Filter DecodeFilter(Options const& opt, std::string const& message, Stats &stats) {
+    Timer t(stats, Decode);
+    std::istringstream is(message);
+    return opt.encoding == "rice" ? Filter::DeserializeEncoded(is) : Filter::Deserialize(is);
+}
+
+void TreeAllreduce(Options const& opt, size_t self, Filter &bf, Network &net, Stats &stats) {
+    const size_t w = opt.numWorkers;
+
+    // Reduce: at distance d, workers at odd multiples of d send to self - d.
+    size_t d = 1;
+    for(; d < w; d *= 2){
+        if(self % (2 * d) == d){
+            net.Send(self, self - d, EncodeFilter(opt, bf, stats), stats);
+            break;
+        }
+        if(self % (2 * d) == 0 && self + d < w){
+            Filter other = DecodeFilter(opt, net.Receive(self, self + d, stats), stats);
+            Timer t(stats, Merge);
+            bf.Union(other);
+        }
+    }
+
+    // Broadcast back down: receive from the parent, then serve children.
+    if(self != 0){
+        bf = DecodeFilter(opt, net.Receive(self, self - d, stats), stats);
+    }
+    std::string encoded;
+    for(d /= 2; d > 0; d /= 2){
+        if(self + d < w){
+            if(encoded.empty()){
+                encoded = EncodeFilter(opt, bf, stats);
+            }
+            net.Send(self, self + d, encoded, stats);
+        }
+    }
+}
+
+void PrintStage(const char *name, std::vector<double> const& seconds) {
+    double max = *std::max_element(seconds.begin(), seconds.end());
+    double sum = 0;
+    for(size_t i = 0; i < seconds.size(); i++){
+        sum += seconds[i];
+    }
+    std::cout << "  " << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << 1e3 * max << std::setw(12) << 1e3 * sum / seconds.size() << std::endl;
+}
+
+int Usage() {
+    std::cerr << "usage: bloom_allreduce_sim [--workers W] [--size N] [--hashes K] [--keys N]"
+              << " [--topology ring|tree] [--encoding raw|rice] [--gbps G] [--seed S]" << std::endl;
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]){
+
+    Options opt;
+    for(int a = 1; a < argc; a++){
+        std::string arg = argv[a];
+        if(a + 1 >= argc){
+            return Usage();
+        }
+        const char *value = argv[++a];
+        if(arg == "--workers"){
+            opt.numWorkers = std::max<size_t>(1, bloom::ParseNumber("--workers", value));
+        } else if(arg == "--size"){
+            opt.size = bloom::ParseNumber("--size", value, 1);
+        } else if(arg == "--hashes"){
+            opt.numHashes = (uint8_t) bloom::ParseNumber("--hashes", value, 1, 255);
+        } else if(arg == "--keys"){
+            opt.numKeys = bloom::ParseNumber("--keys", value);
+        } else if(arg == "--topology"){
+            opt.topology = value;
+        } else if(arg == "--encoding"){
+            opt.encoding = value;
+        } else if(arg == "--gbps"){
+            opt.gbps = atof(value);
+        } else if(arg == "--seed"){
+            opt.seed = bloom::ParseNumber("--seed", value);
+        } else {
+            return Usage();
+        }
+    }
+    if((opt.topology != "ring" && opt.topology != "tree") || (opt.encoding != "raw" && opt.encoding != "rice")){
+        return Usage();
+    }
+
+    const size_t w = opt.numWorkers;
+    std::vector<Filter> filters(w, Filter(opt.numHashes, opt.size));
+    std::vector<Stats> stats(w);
+
+    bloom::ForEachChunk(w, [&](size_t self){
+        Timer t(stats[self], Build);
+        std::mt19937_64 rng(opt.seed * 1000003 + self);
+        for(size_t i = 0; i < opt.numKeys; i++){
+            filters[self].Insert(rng());
+        }
+    });
+
+    // The expected result, computed outside the measured stages.
+    Filter expected(opt.numHashes, opt.size);
+    for(size_t i = 0; i < w; i++){
+        expected.Union(filters[i]);
+    }
+
+    Network net(w, opt.gbps);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bloom::ForEachChunk(w, [&](size_t self){
+        if(opt.topology == "ring"){
+            RingAllreduce(opt, self, filters[self], net, stats[self]);
+        } else {
+            TreeAllreduce(opt, self, filters[self], net, stats[self]);
+        }
+    });
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+    bool agree = true;
+    for(size_t i = 0; i < w; i++){
+        agree = agree && std::equal(expected.Data(), expected.Data() + opt.size, filters[i].Data());
+    }
+
+    uint64_t bytes = 0, maxBytes = 0, messages = 0;
+    for(size_t i = 0; i < w; i++){
+        bytes += stats[i].bytesSent;
+        maxBytes = std::max(maxBytes, stats[i].bytesSent);
+        messages += stats[i].messages;
+    }
+    size_t setBits = expected.CountBits();
+
+    std::cout << w << " workers, " << opt.size << " bytes, " << (int) opt.numHashes << " hashes, "
+              << opt.numKeys << " keys per worker, " << opt.topology << ", " << opt.encoding << std::endl;
+    std::cout << "  stage          max ms     mean ms" << std::endl;
+    for(int s = 0; s < NumStages; s++){
+        std::vector<double> seconds(w);
+        for(size_t i = 0; i < w; i++){
+            seconds[i] = stats[i].seconds[s];
+        }
+        PrintStage(StageNames[s], seconds);
+    }
+    std::cout << "  allreduce wall time: " << 1e3 * wall.count() << " ms" << std::endl;
+    std::cout << "  bytes sent: " << bytes << " total, " << maxBytes << " by the busiest worker, in "
+              << messages << " messages (" << std::setprecision(2) << (double) bytes / (w * opt.size)
+              << " filter sizes per worker)" << std::endl;
+    std::cout << "  result: " << std::setprecision(4) << (double) setBits / (8.0 * opt.size) << " fill, ~"
+              << std::setprecision(0) << expected.EstimateCardinality(setBits) << " keys, "
+              << (agree ? "all workers agree" : "WORKERS DISAGREE") << std::endl;
+
+    return agree ? 0 : 1;
+}
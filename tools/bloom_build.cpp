@@ -0,0 +1,163 @@
+/** Builds a Bloom filter from a key file and writes it in the filter's
+ *  Serialize format.
+ *
+ *  Usage: bloom_build [options] <keys> <output>
+ *
+ *    --type ordinary|counting|paired|static   Filter to build (ordinary)
+ *    --format text|u32                        One key per line, or raw
+ *                                             little-endian uint32 keys (text)
+ *    --hashes K                               Hashes per key (4)
+ *    --size N                                 Bytes (ordinary), counters
+ *                                             (counting) or bits per half,
+ *                                             rounded up to a multiple of 8
+ *                                             (paired); unused for static
+ *    --threads N                              Worker threads, at most
+ *                                             1024 (all cores)
+ *
+ *  The key file is memory-mapped and split into one chunk per thread. Each
+ *  thread parses its chunk a batch of keys at a time and inserts the batch
+ *  before parsing the next, so memory beyond the filter does not grow with
+ *  the number of keys. Ordinary (and paired) filters are filled with atomic
+ *  ORs on one shared bit array, and counting filters with atomic saturating
+ *  increments on one shared counter array, so it does not grow with the
+ *  number of threads either. Static filters are built from all keys at
+ *  once and are the exception.
+ */
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "KeyFile.hpp"
+#include "OrdinaryBloomFilter.hpp"
+#include "StaticFilter.hpp"
+
+namespace {
+
+struct Options {
+    std::string type = "ordinary";
+    std::string format = "text";
+    uint8_t numHashes = 4;
+    size_t size = 1 << 20;
+    size_t numThreads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), bloom::MaxThreads);
+};
+
+template <typename Source>
+bloom::OrdinaryBloomFilter<typename Source::Key> BuildOrdinary(Options const& opt, size_t numBytes, Source const& source) {
+    typedef typename Source::Key K;
+    typedef bloom::OrdinaryBloomFilter<K> Filter;
+    Filter bf(opt.numHashes, numBytes);
+    unsigned char *bits = bf.Get_bloom().data();
+
+    bloom::ForEachChunk(source.NumChunks(), [&](size_t c){
+        std::vector<size_t> pos(bloom::KeyBatchSize * opt.numHashes);
+        source.ForEachBatch(c, [&](const K *keys, size_t m){
+            for(size_t j = 0; j < m * opt.numHashes; j++){
+                pos[j] = Filter::BitIndex(keys[j / opt.numHashes], (uint8_t) (j % opt.numHashes), numBytes);
+                bloom::PrefetchRead(&bits[pos[j] / 8]);
+            }
+            for(size_t j = 0; j < m * opt.numHashes; j++){
+                // Threads may set bits in the same byte concurrently.
+                __atomic_fetch_or(&bits[pos[j] / 8], (unsigned char) (1u << (pos[j] % 8)), __ATOMIC_RELAXED);
+            }
+        });
+    });
+    return bf;
+}
+
+template <typename Source>
+void Build(Options const& opt, Source const& source, std::ostream &os) {
+    typedef typename Source::Key K;
+    if(opt.type == "ordinary"){
+        BuildOrdinary(opt, opt.size, source).Serialize(os);
+    } else if(opt.type == "paired"){
+        BuildOrdinary(opt, (opt.size + 7) / 8, source).ToPairedBloomFilter().Serialize(os);
+    } else if(opt.type == "counting"){
+        bloom::CountingBloomFilter<K> bf(opt.numHashes, opt.size);
+        bloom::ForEachChunk(source.NumChunks(), [&](size_t c){
+            source.ForEachBatch(c, [&](const K *keys, size_t m){
+                for(size_t j = 0; j < m; j++){
+                    bf.InsertShared(keys[j]);
+                }
+            });
+        });
+        bf.Serialize(os);
+    } else {
+        // The static filter is solved over the whole key set at once.
+        std::vector<K> keys;
+        for(size_t c = 0; c < source.NumChunks(); c++){
+            source.ForEachBatch(c, [&](const K *batch, size_t m){
+                keys.insert(keys.end(), batch, batch + m);
+            });
+        }
+        bloom::StaticFilter<K>::Build(keys.data(), keys.size(), opt.numThreads).Serialize(os);
+    }
+}
+
+int Usage() {
+    std::cerr << "usage: bloom_build [--type ordinary|counting|paired|static] [--format text|u32]"
+              << " [--hashes K] [--size N] [--threads N] <keys> <output>" << std::endl;
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]){
+
+    Options opt;
+    std::vector<const char *> paths;
+    for(int a = 1; a < argc; a++){
+        std::string arg = argv[a];
+        if(arg.compare(0, 2, "--") != 0){
+            paths.push_back(argv[a]);
+            continue;
+        }
+        if(a + 1 >= argc){
+            return Usage();
+        }
+        const char *value = argv[++a];
+        if(arg == "--type"){
+            opt.type = value;
+        } else if(arg == "--format"){
+            opt.format = value;
+        } else if(arg == "--hashes"){
+            opt.numHashes = (uint8_t) bloom::ParseNumber("--hashes", value, 1, 255);
+        } else if(arg == "--size"){
+            opt.size = bloom::ParseNumber("--size", value, 1);
+        } else if(arg == "--threads"){
+            opt.numThreads = bloom::ParseNumber("--threads", value, 1, bloom::MaxThreads);
+        } else {
+            return Usage();
+        }
+    }
+    bool knownType = opt.type == "ordinary" || opt.type == "counting" || opt.type == "paired" || opt.type == "static";
+    if(paths.size() != 2 || !knownType || (opt.format != "text" && opt.format != "u32")){
+        return Usage();
+    }
+
+    try {
+        bloom::MappedFile file(paths[0]);
+        std::ofstream out(paths[1], std::ios::binary);
+        if(!out){
+            std::cerr << "cannot open " << paths[1] << std::endl;
+            return 1;
+        }
+
+        if(opt.format == "text"){
+            Build(opt, bloom::TextKeys(file, opt.numThreads), out);
+        } else {
+            Build(opt, bloom::U32Keys(file, opt.numThreads), out);
+        }
+
+        if(!out){
+            std::cerr << "error writing " << paths[1] << std::endl;
+            return 1;
+        }
+    } catch(std::exception const& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+/** Queries every key of a key file against a filter written by bloom_build
+ *  (or any Serialize call) and prints one result per key, in file order:
+ *  1 or 0, or the estimated count for counting filters.
+ *
+ *  Usage: bloom_query [options] <filter> <keys>
+ *
+ *    --type ordinary|counting|paired|static   Filter type (ordinary)
+ *    --format text|u32                        Key file format (text)
+ *    --threads N                              Worker threads, at most
+ *                                             1024 (all cores)
+ *    --summary                                Print only the number of keys
+ *                                             found and queried
+ *
+ *  Keys are parsed and queried in parallel chunks, a batch at a time;
+ *  ordinary filters use the pipelined QueryBatch. Results are printed in
+ *  file order, so unless --summary is given one byte per key is kept until
+ *  every chunk is done.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "KeyFile.hpp"
+#include "OrdinaryBloomFilter.hpp"
+#include "StaticFilter.hpp"
+
+namespace {
+
+struct Options {
+    std::string type = "ordinary";
+    std::string format = "text";
+    size_t numThreads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), bloom::MaxThreads);
+    bool summary = false;
+};
+
+/** Runs query(keys, n, out) on every batch of every chunk in parallel,
+ *  then prints the results in order.
+ */
+template <typename Source, typename Query>
+void Run(Options const& opt, Source const& source, Query query) {
+    typedef typename Source::Key K;
+    size_t numChunks = source.NumChunks();
+    std::vector<std::vector<uint8_t>> results(numChunks);
+    std::vector<size_t> found(numChunks, 0), total(numChunks, 0);
+    bloom::ForEachChunk(numChunks, [&](size_t c){
+        std::vector<uint8_t> out(bloom::KeyBatchSize);
+        source.ForEachBatch(c, [&](const K *keys, size_t n){
+            query(keys, n, out.data());
+            for(size_t j = 0; j < n; j++){
+                found[c] += out[j] != 0;
+            }
+            total[c] += n;
+            if(!opt.summary){
+                results[c].insert(results[c].end(), out.begin(), out.begin() + n);
+            }
+        });
+    });
+
+    if(opt.summary){
+        size_t allFound = 0, all = 0;
+        for(size_t c = 0; c < numChunks; c++){
+            allFound += found[c];
+            all += total[c];
+        }
+        printf("%zu of %zu keys found\n", allFound, all);
+        return;
+    }
+    std::string line;
+    for(size_t c = 0; c < numChunks; c++){
+        for(size_t j = 0; j < results[c].size(); j++){
+            line = std::to_string(results[c][j]);
+            line.push_back('\n');
+            fwrite(line.data(), 1, line.size(), stdout);
+        }
+    }
+}
+
+template <typename Source>
+void Query(Options const& opt, std::istream &is, Source const& source) {
+    typedef typename Source::Key K;
+    if(opt.type == "ordinary"){
+        bloom::OrdinaryBloomFilter<K> bf = bloom::OrdinaryBloomFilter<K>::Deserialize(is);
+        Run(opt, source, [&](const K *keys, size_t n, uint8_t *out){
+            std::vector<char> present(n);
+            bf.QueryBatch(keys, n, reinterpret_cast<bool *>(present.data()));
+            std::copy(present.begin(), present.end(), out);
+        });
+    } else if(opt.type == "counting"){
+        bloom::CountingBloomFilter<K> bf = bloom::CountingBloomFilter<K>::Deserialize(is);
+        Run(opt, source, [&](const K *keys, size_t n, uint8_t *out){
+            bf.EstimateCountBatch(keys, n, out);
+        });
+    } else if(opt.type == "paired"){
+        bloom::PairedBloomFilter<K> bf = bloom::PairedBloomFilter<K>::Deserialize(is);
+        Run(opt, source, [&](const K *keys, size_t n, uint8_t *out){
+            for(size_t j = 0; j < n; j++){
+                out[j] = bf.Query(keys[j]);
+            }
+        });
+    } else {
+        bloom::StaticFilter<K> sf = bloom::StaticFilter<K>::Deserialize(is);
+        Run(opt, source, [&](const K *keys, size_t n, uint8_t *out){
+            for(size_t j = 0; j < n; j++){
+                out[j] = sf.Query(keys[j]);
+            }
+        });
+    }
+}
+
+int Usage() {
+    std::cerr << "usage: bloom_query [--type ordinary|counting|paired|static] [--format text|u32]"
+              << " [--threads N] [--summary] <filter> <keys>" << std::endl;
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]){
+
+    Options opt;
+    std::vector<const char *> paths;
+    for(int a = 1; a < argc; a++){
+        std::string arg = argv[a];
+        if(arg.compare(0, 2, "--") != 0){
+            paths.push_back(argv[a]);
+            continue;
+        }
+        if(arg == "--summary"){
+            opt.summary = true;
+            continue;
+        }
+        if(a + 1 >= argc){
+            return Usage();
+        }
+        const char *value = argv[++a];
+        if(arg == "--type"){
+            opt.type = value;
+        } else if(arg == "--format"){
+            opt.format = value;
+        } else if(arg == "--threads"){
+            opt.numThreads = bloom::ParseNumber("--threads", value, 1, bloom::MaxThreads);
+        } else {
+            return Usage();
+        }
+    }
+    bool knownType = opt.type == "ordinary" || opt.type == "counting" || opt.type == "paired" || opt.type == "static";
+    if(paths.size() != 2 || !knownType || (opt.format != "text" && opt.format != "u32")){
+        return Usage();
+    }
+
+    try {
+        std::ifstream in(paths[0], std::ios::binary);
+        if(!in){
+            std::cerr << "cannot open " << paths[0] << std::endl;
+            return 1;
+        }
+        bloom::MappedFile file(paths[1]);
+
+        if(opt.format == "text"){
+            Query(opt, in, bloom::TextKeys(file, opt.numThreads));
+        } else {
+            Query(opt, in, bloom::U32Keys(file, opt.numThreads));
+        }
+    } catch(std::exception const& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}